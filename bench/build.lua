@@ -0,0 +1,36 @@
+project "thumper_bench"
+debugdir "../working"
+kind "ConsoleApp"
+
+files {
+	"%{prj.location}/**.cpp",
+	"%{prj.location}/**.hpp",
+
+	-- Only the parts of the editor that run without a window
+	"%{wks.location}/editor/source/te_hash.cpp",
+	"%{wks.location}/editor/source/te_level.cpp",
+	"%{wks.location}/editor/source/te_level_details.cpp",
+	"%{wks.location}/editor/source/te_level_list.cpp",
+	"%{wks.location}/editor/source/te_level_pack.cpp",
+	"%{wks.location}/editor/source/te_level_table.cpp",
+	"%{wks.location}/editor/source/te_mapped_file.cpp",
+	"%{wks.location}/editor/source/te_profiler.cpp",
+	"%{wks.location}/editor/source/te_thread_pool.cpp",
+	"%{wks.location}/editor/source/te_util.cpp",
+	"%{wks.location}/editor/source/te_waveform.cpp",
+	"%{wks.location}/editor/vendor/stb_vorbis.c",
+}
+
+includedirs {
+	"%{prj.location}/source",
+	"%{wks.location}/editor/source",
+	"%{wks.location}/editor/vendor",
+
+	"%{wks.location}/vendor/yaml/include",
+}
+
+defines "YAML_CPP_STATIC_DEFINE"
+links "yaml"
+
+filter "system:linux"
+links { "pthread", "dl", "m" }
@@ -0,0 +1,891 @@
+#include "te_hash.hpp"
+#include "te_image.hpp"
+#include "te_known_names.hpp"
+#include "te_level.hpp"
+#include "te_level_details.hpp"
+#include "te_level_pack.hpp"
+#include "te_level_table.hpp"
+#include "te_profiler.hpp"
+#include "te_thread_pool.hpp"
+#include "te_util.hpp"
+#include "te_waveform.hpp"
+
+#include <miniaudio.h>
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <latch>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    constexpr int kExitUsage = 2;
+    constexpr size_t kFixtureLevels = 500;
+
+    struct Options {
+        std::string filter;
+        std::string jsonPath;
+        std::string baselinePath;
+        std::string imagePath = "diff.png";
+        std::string levelsPath = "levels";
+        double threshold = 10.0;
+        double minSeconds = 0.5;
+        size_t minSamples = 25;
+    };
+
+    struct Result {
+        std::string name;
+        size_t samples = 0;
+        uint64_t iterations = 0;
+        double minNs = 0.0;
+        double medianNs = 0.0;
+        double p90Ns = 0.0;
+        double p99Ns = 0.0;
+        // Median absolute deviation, a spread estimate that ignores the odd preempted sample
+        double madNs = 0.0;
+        double bytesPerOp = 0.0;
+    };
+
+    // Stores keep results of pure calls alive past link time optimization
+    volatile uint64_t gSink = 0;
+
+    void keep(uint64_t value) {
+        gSink = value;
+    }
+
+    std::mutex gWakeMutex;
+    std::condition_variable gWakeCondition;
+    bool gWoken = false;
+
+    void bench_wake() {
+        {
+            std::lock_guard lock(gWakeMutex);
+            gWoken = true;
+        }
+        gWakeCondition.notify_all();
+    }
+
+    void bench_wait() {
+        std::unique_lock lock(gWakeMutex);
+        gWakeCondition.wait_for(lock, std::chrono::milliseconds(100), []() { return gWoken; });
+        gWoken = false;
+    }
+
+    double percentile(std::vector<double> const& sorted, double q) {
+        size_t const index = static_cast<size_t>(q * static_cast<double>(sorted.size() - 1) + 0.5);
+        return sorted[std::min(index, sorted.size() - 1)];
+    }
+
+    class Runner final {
+    public:
+        explicit Runner(Options const& options) : mOptions(options) {}
+
+        // `body(n)` runs the operation n times, the batch size is doubled until one batch takes a couple of milliseconds
+        void run(std::string name, double bytesPerOp, std::function<void(uint64_t)> const& body) {
+            if (!mOptions.filter.empty() && name.find(mOptions.filter) == std::string::npos) return;
+
+            auto const time = [&](uint64_t iterations) {
+                auto const start = Clock::now();
+                body(iterations);
+                return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+            };
+
+            // Calibrating doubles as the warm up
+            uint64_t iterations = 1;
+            while (iterations < (uint64_t(1) << 30) && time(iterations) < 2e6)
+                iterations *= 2;
+
+            std::vector<double> samples;
+            auto const start = Clock::now();
+            while (samples.size() < 1000 && (samples.size() < mOptions.minSamples || std::chrono::duration<double>(Clock::now() - start).count() < mOptions.minSeconds))
+                samples.push_back(time(iterations) / static_cast<double>(iterations));
+
+            std::sort(samples.begin(), samples.end());
+
+            Result result;
+            result.name = std::move(name);
+            result.samples = samples.size();
+            result.iterations = iterations;
+            result.minNs = samples.front();
+            result.medianNs = percentile(samples, 0.5);
+            result.p90Ns = percentile(samples, 0.9);
+            result.p99Ns = percentile(samples, 0.99);
+            result.bytesPerOp = bytesPerOp;
+
+            std::vector<double> deviations(samples.size());
+            for (size_t i = 0; i < samples.size(); ++i)
+                deviations[i] = std::abs(samples[i] - result.medianNs);
+            std::sort(deviations.begin(), deviations.end());
+            result.madNs = percentile(deviations, 0.5);
+
+            print(result);
+            mResults.emplace_back(std::move(result));
+        }
+
+        inline std::vector<Result> const& results() const { return mResults; }
+    private:
+        static void print(Result const& result) {
+            char throughput[32] = "";
+            if (result.bytesPerOp > 0.0)
+                snprintf(throughput, sizeof(throughput), "%10.1f MB/s", result.bytesPerOp / result.medianNs * 1e3);
+
+            fprintf(stderr, "%-32s %12.1f ns  p90 %12.1f  p99 %12.1f  mad %5.1f%%  %s\n",
+                result.name.c_str(), result.medianNs, result.p90Ns, result.p99Ns, result.madNs / result.medianNs * 100.0, throughput);
+        }
+
+        Options const& mOptions;
+        std::vector<Result> mResults;
+    };
+
+    // Levels shaped like the ones the custom level editor exports, removed again on destruction
+    class Fixture final {
+    public:
+        Fixture() {
+            std::random_device device;
+            mRoot = std::filesystem::temp_directory_path() / ("thumper_bench_" + std::to_string(device()));
+            mLevels = mRoot / "levels";
+
+            for (size_t i = 0; i < kFixtureLevels; ++i) {
+                std::filesystem::path const directory = mLevels / ("level_" + std::to_string(i));
+                std::filesystem::create_directories(directory);
+
+                std::ofstream file(directory / "LEVEL DETAILS.txt", std::ios::out | std::ios::binary);
+
+                // Some hand written yaml in between, the fast parser has a separate path for it
+                if (i % 4 == 3) {
+                    file << "# written by hand\n"
+                        << "level_name: Benchmark Level " << i << "\n"
+                        << "difficulty: D" << (i % 8) << "\n"
+                        << "description: 'A generated level, it''s used to time the library scan.'\n"
+                        << "author: bench # not part of the name\n";
+                    continue;
+                }
+
+                file << "{\n"
+                    << "  \"level_name\": \"Benchmark Level " << i << "\",\n"
+                    << "  \"difficulty\": \"D" << (i % 8) << "\",\n"
+                    << "  \"description\": \"A generated level used to time the library scan.\\nSecond line of the description.\",\n"
+                    << "  \"author\": \"bench\",\n"
+                    << "  \"bpm\": " << 120 + i % 200 << "\n"
+                    << "}\n";
+            }
+        }
+
+        ~Fixture() noexcept {
+            std::error_code ec;
+            std::filesystem::remove_all(mRoot, ec);
+        }
+
+        Fixture(Fixture const&) = delete;
+        Fixture& operator=(Fixture const&) = delete;
+
+        inline std::filesystem::path const& root() const { return mRoot; }
+        inline std::filesystem::path const& levels() const { return mLevels; }
+    private:
+        std::filesystem::path mRoot;
+        std::filesystem::path mLevels;
+    };
+
+    // Returns once every task submitted so far has finished, all workers have to meet in here first
+    void drain(ThreadPool& pool) {
+        auto arrived = std::make_shared<std::latch>(pool.size());
+        auto done = std::make_shared<std::latch>(pool.size() + 1);
+
+        for (unsigned int i = 0; i < pool.size(); ++i) {
+            pool.submit([arrived, done]() {
+                arrived->arrive_and_wait();
+                done->count_down();
+            });
+        }
+
+        done->arrive_and_wait();
+    }
+
+    void scan_library(ThreadPool& pool, std::filesystem::path const& root, std::filesystem::path const& indexPath) {
+        LevelLibrary library(pool, root, indexPath);
+        library.scan();
+
+        while (library.scanning()) {
+            bench_wait();
+            library.poll();
+        }
+
+        // Also waits out the index save `poll` queued, so runs never overlap
+        drain(pool);
+        keep(library.levels().size());
+    }
+
+    void bench_hash(Runner& runner) {
+        std::mt19937 random(1234);
+
+        for (size_t size : { 8, 32, 128, 1024, 65536 }) {
+            std::vector<unsigned char> buffer(size);
+            for (auto& byte : buffer) byte = static_cast<unsigned char>(random());
+
+            runner.run("hash32/" + std::to_string(size), static_cast<double>(size), [&](uint64_t iterations) {
+                for (uint64_t i = 0; i < iterations; ++i) {
+                    // A changing first byte keeps the call from being hoisted out of the loop
+                    buffer[0] = static_cast<unsigned char>(i);
+                    keep(hash32(buffer.data(), static_cast<unsigned int>(buffer.size())));
+                }
+            });
+        }
+
+        // Asset path shaped names, the batch path's intended workload
+        std::vector<std::string> storage(4096);
+        size_t totalBytes = 0;
+        for (size_t i = 0; i < storage.size(); ++i) {
+            storage[i] = "Alevels/custom/level_" + std::to_string(i) + "/sequin_" + std::to_string(random() % 1000) + ".objlib";
+            totalBytes += storage[i].size();
+        }
+
+        std::vector<std::string_view> names(storage.begin(), storage.end());
+        std::vector<uint32_t> hashes(names.size());
+
+        for (HashIsa isa : { HashIsa::Scalar, HashIsa::Sse41, HashIsa::Avx2 }) {
+            if (static_cast<int>(isa) > static_cast<int>(hash32_detect_isa())) continue;
+
+            runner.run(std::string("hash32_batch/") + hash32_isa_name(isa), static_cast<double>(totalBytes), [&](uint64_t iterations) {
+                for (uint64_t i = 0; i < iterations; ++i) {
+                    hash32_batch(names, hashes, isa);
+                    keep(hashes[i % hashes.size()]);
+                }
+            });
+        }
+
+        // Mostly misses like a real cache listing, with every known name mixed in
+        for (auto const& slot : kKnownNames.slots())
+            if (!slot.name.empty()) hashes[random() % hashes.size()] = slot.hash;
+
+        runner.run("known_name/lookup", 0.0, [&](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; ++i)
+                keep(known_name(hashes[i % hashes.size()]).has_value());
+        });
+    }
+
+    // Hashed by the compiler in chunks, each one a separate constant expression to stay under
+    // msvc's constexpr step limit
+    constexpr size_t kCorpusChunk = 128;
+    constexpr size_t kCorpusChunks = 32;
+
+    struct CorpusName {
+        std::array<char, 48> bytes{};
+        size_t size = 0;
+
+        constexpr std::string_view view() const { return { bytes.data(), size }; }
+    };
+
+    // Every length up to 47 and every byte value, the high ones catch a signed char slipping into the hash
+    constexpr CorpusName corpus_name(size_t index) {
+        CorpusName name;
+        uint32_t state = static_cast<uint32_t>(index) * 0x9e3779b9u + 0x7f4a7c15u;
+
+        name.size = index % name.bytes.size();
+        for (size_t i = 0; i < name.size; ++i) {
+            state = state * 1664525u + 1013904223u;
+            name.bytes[i] = static_cast<char>(state >> 24);
+        }
+
+        return name;
+    }
+
+    template <size_t First>
+    constexpr std::array<uint32_t, kCorpusChunk> kCorpusHashes = []() {
+        std::array<uint32_t, kCorpusChunk> hashes{};
+        for (size_t i = 0; i < kCorpusChunk; ++i)
+            hashes[i] = hash32(corpus_name(First + i).view());
+        return hashes;
+    }();
+
+    template <size_t... Chunks>
+    std::vector<uint32_t> corpus_hashes(std::index_sequence<Chunks...>) {
+        std::vector<uint32_t> hashes;
+        (hashes.insert(hashes.end(), kCorpusHashes<Chunks * kCorpusChunk>.begin(), kCorpusHashes<Chunks * kCorpusChunk>.end()), ...);
+        return hashes;
+    }
+
+    // Compares hashes the compiler produced against every runtime path, returns the number of disagreements
+    size_t check_hash32() {
+        std::vector<uint32_t> const expected = corpus_hashes(std::make_index_sequence<kCorpusChunks>());
+
+        std::vector<CorpusName> corpus(expected.size());
+        std::vector<std::string_view> names(expected.size());
+        for (size_t i = 0; i < corpus.size(); ++i) {
+            corpus[i] = corpus_name(i);
+            names[i] = corpus[i].view();
+        }
+
+        size_t mismatches = 0;
+        for (size_t i = 0; i < names.size(); ++i) {
+            if (hash32(names[i]) != expected[i] || hash32(reinterpret_cast<unsigned char const*>(names[i].data()), static_cast<unsigned int>(names[i].size())) != expected[i])
+                ++mismatches;
+        }
+
+        std::vector<uint32_t> hashes(names.size());
+        for (HashIsa isa : { HashIsa::Scalar, HashIsa::Sse41, HashIsa::Avx2 }) {
+            if (static_cast<int>(isa) > static_cast<int>(hash32_detect_isa())) continue;
+
+            hash32_batch(names, hashes, isa);
+            for (size_t i = 0; i < names.size(); ++i)
+                if (hashes[i] != expected[i]) ++mismatches;
+        }
+
+        // Round trip every known name through strings only known at runtime
+        size_t known = 0;
+        for (auto const& slot : kKnownNames.slots()) {
+            if (slot.name.empty()) continue;
+            ++known;
+
+            std::string const name(slot.name);
+            if (hash32(name) != slot.hash || known_name(hash32(name)) != slot.name || known_hash(name) != slot.hash) {
+                fprintf(stderr, "known name mismatch: %s\n", name.c_str());
+                ++mismatches;
+            }
+        }
+
+        fprintf(stderr, "hash32: %zu names hashed at compile time, %zu known names, up to %s, %zu mismatches\n",
+            expected.size(), known, hash32_isa_name(hash32_detect_isa()), mismatches);
+        return mismatches;
+    }
+
+    std::string read_file(std::filesystem::path const& path) {
+        std::ifstream file(path, std::ios::in | std::ios::binary);
+        return std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    }
+
+    // Compares the fast details parser against yaml-cpp on every level under `root`, returns the number of disagreements
+    size_t check_level_details(std::filesystem::path const& root) {
+        size_t files = 0, fast = 0, mismatches = 0;
+
+        std::error_code ec;
+        if (!std::filesystem::is_directory(root, ec)) return 0;
+
+        for (auto it = std::filesystem::directory_iterator(root, ec); !ec && it != std::filesystem::directory_iterator(); it.increment(ec)) {
+            std::filesystem::path const path = it->path() / "LEVEL DETAILS.txt";
+            if (!std::filesystem::is_regular_file(path, ec)) continue;
+
+            std::string const text = read_file(path);
+            ++files;
+
+            Level expected, actual;
+            bool const parsed = parse_level_details_yaml(text, expected);
+            if (!parse_level_details_fast(text, actual)) continue;
+            ++fast;
+
+            if (!parsed || actual.name != expected.name || actual.difficulty != expected.difficulty || actual.description != expected.description || actual.author != expected.author) {
+                fprintf(stderr, "level details mismatch: %s\n", path_to_string(path).c_str());
+                ++mismatches;
+            }
+        }
+
+        fprintf(stderr, "%s: %zu level details, %zu read by the fast parser, %zu left to yaml-cpp, %zu mismatches\n",
+            path_to_string(root).c_str(), files, fast, files - fast, mismatches);
+        return mismatches;
+    }
+
+    void bench_levels(Runner& runner, Fixture const& fixture) {
+        ThreadPool pool;
+        set_wake_handler(&bench_wake);
+
+        // The index can never be written here, every scan parses all details files
+        std::filesystem::path const unwritable = fixture.root() / "missing" / "level_index.bin";
+        runner.run("level_scan/cold", 0.0, [&](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; ++i)
+                scan_library(pool, fixture.levels(), unwritable);
+        });
+
+        std::filesystem::path const index = fixture.root() / "level_index.bin";
+        scan_library(pool, fixture.levels(), index);
+
+        runner.run("level_scan/indexed", 0.0, [&](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; ++i)
+                scan_library(pool, fixture.levels(), index);
+        });
+
+        set_wake_handler(nullptr);
+
+        // level_0 is the editor's JSON, level_3 the hand written yaml
+        for (auto [directory, style] : { std::pair(fixture.levels() / "level_0", "json"), std::pair(fixture.levels() / "level_3", "block") }) {
+            std::string const text = read_file(directory / "LEVEL DETAILS.txt");
+            double const size = static_cast<double>(text.size());
+            Level level;
+
+            runner.run(std::string("level_details/fast/") + style, size, [&](uint64_t iterations) {
+                for (uint64_t i = 0; i < iterations; ++i)
+                    keep(parse_level_details_fast(text, level));
+            });
+
+            runner.run(std::string("level_details/yaml/") + style, size, [&](uint64_t iterations) {
+                for (uint64_t i = 0; i < iterations; ++i)
+                    keep(parse_level_details_yaml(text, level));
+            });
+
+            runner.run(std::string("level_details/load/") + style, size, [&](uint64_t iterations) {
+                for (uint64_t i = 0; i < iterations; ++i)
+                    keep(load_level(directory).has_value());
+            });
+        }
+    }
+
+    // Startup cost of a saved library, mapping the snapshot plus the table's first frame
+    void bench_snapshot(Runner& runner, Fixture const& fixture) {
+        for (size_t count : { 500, 50000 }) {
+            LevelList levels;
+            for (size_t i = 0; i < count; ++i) {
+                Level level;
+                level.path = "levels/level_" + std::to_string(i);
+                level.name = "Benchmark Level " + std::to_string(i);
+                level.difficulty = "D" + std::to_string(i % 8);
+                level.description = "A generated level used to time the level snapshot.";
+                level.author = "bench";
+                level.modified = static_cast<int64_t>(i);
+                level.size = 200;
+                levels.push_back(level);
+            }
+
+            std::filesystem::path const path = fixture.root() / ("snapshot_" + std::to_string(count) + ".bin");
+            levels.save(path, sort_levels(levels, LevelColumn::Name));
+
+            std::error_code ec;
+            double const size = static_cast<double>(std::filesystem::file_size(path, ec));
+
+            runner.run("level_snapshot/open/" + std::to_string(count), 0.0, [&](uint64_t iterations) {
+                for (uint64_t i = 0; i < iterations; ++i) {
+                    LevelList mapped;
+                    mapped.map(path, false);
+
+                    LevelTableModel table;
+                    table.update(mapped, 1, true);
+                    keep(table.rows().size());
+                }
+            });
+
+            runner.run("level_snapshot/verify/" + std::to_string(count), size, [&](uint64_t iterations) {
+                for (uint64_t i = 0; i < iterations; ++i) {
+                    LevelList mapped;
+                    keep(mapped.map(path, true));
+                }
+            });
+        }
+    }
+
+    // Listing a pack against `level_scan/cold` over the same levels, plus the codec on their details files
+    // Inputs the level details do not cover: nothing, bytes that never repeat, and runs long
+    // enough for matches that overlap themselves and lengths spilling past the token
+    std::vector<std::vector<std::byte>> lz_inputs(std::span<std::byte const> text) {
+        std::vector<std::vector<std::byte>> inputs;
+        inputs.emplace_back();
+        inputs.emplace_back(text.begin(), text.end());
+
+        std::mt19937 random(7);
+        std::vector<std::byte>& noise = inputs.emplace_back(1 << 16);
+        for (std::byte& byte : noise) byte = static_cast<std::byte>(random());
+
+        std::vector<std::byte>& runs = inputs.emplace_back();
+        for (size_t run = 0; run < 64; ++run)
+            runs.insert(runs.end(), random() % 2000, static_cast<std::byte>(run % 3));
+
+        return inputs;
+    }
+
+    // Benchmarks the pack and the codec after checking both give back what went in, returns the number of disagreements
+    size_t bench_pack(Runner& runner, Fixture const& fixture) {
+        std::vector<std::filesystem::path> directories;
+        std::string text;
+        for (size_t i = 0; i < kFixtureLevels; ++i) {
+            directories.push_back(fixture.levels() / ("level_" + std::to_string(i)));
+            text += read_file(directories.back() / "LEVEL DETAILS.txt");
+        }
+
+        size_t mismatches = 0;
+
+        std::filesystem::path const path = fixture.root() / "levels.tepack";
+        LevelPackReport report;
+        if (!LevelPack::write(path, directories, true, report) || report.levels != kFixtureLevels) {
+            fprintf(stderr, "level pack: wrote %zu of %zu levels\n", report.levels, kFixtureLevels);
+            ++mismatches;
+        }
+
+        LevelPack pack;
+        if (!pack.open(path) || pack.level_count() != kFixtureLevels) {
+            fprintf(stderr, "level pack: could not be opened again\n");
+            ++mismatches;
+        }
+
+        std::vector<std::byte> contents;
+        for (size_t i = 0; i < pack.entry_count(); ++i) {
+            std::string_view const name = pack.entry(i).name;
+            std::string const original = read_file(fixture.levels() / std::filesystem::path(std::string(name)));
+            if (!pack.read(i, contents) || std::string_view(reinterpret_cast<char const*>(contents.data()), contents.size()) != original) {
+                fprintf(stderr, "level pack: %.*s reads back different\n", static_cast<int>(name.size()), name.data());
+                ++mismatches;
+            }
+        }
+
+        std::filesystem::path const unpacked = fixture.root() / "unpacked";
+        LevelPackReport extracted;
+        if (!pack.extract(unpacked, extracted) || extracted.levels != kFixtureLevels) {
+            fprintf(stderr, "level pack: extracted %zu of %zu levels\n", extracted.levels, kFixtureLevels);
+            ++mismatches;
+        }
+        for (auto const& directory : directories) {
+            std::filesystem::path const relative = std::filesystem::path(directory.filename()) / "LEVEL DETAILS.txt";
+            if (read_file(unpacked / relative) != read_file(fixture.levels() / relative)) {
+                fprintf(stderr, "level pack: %s extracts different\n", path_to_string(relative).c_str());
+                ++mismatches;
+            }
+        }
+        pack.close();
+
+        auto const input = std::as_bytes(std::span(text));
+        for (auto const& original : lz_inputs(input)) {
+            std::vector<std::byte> const packed = lz_compress(original);
+            std::vector<std::byte> decoded(original.size());
+            if (!lz_decompress(packed, decoded) || decoded != original) {
+                fprintf(stderr, "lz: %zu bytes do not survive a round trip\n", original.size());
+                ++mismatches;
+            }
+        }
+
+        runner.run("level_pack/write", 0.0, [&](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; ++i) {
+                LevelPackReport written;
+                keep(LevelPack::write(fixture.root() / "levels_write.tepack", directories, true, written));
+            }
+        });
+
+        runner.run("level_pack/open", 0.0, [&](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; ++i) {
+                LevelPack pack;
+                pack.open(path);
+
+                size_t names = 0;
+                for (size_t level = 0; level < pack.level_count(); ++level)
+                    names += pack.level(level).name.size();
+                keep(names);
+            }
+        });
+
+        std::vector<std::byte> const compressed = lz_compress(input);
+        std::vector<std::byte> output(input.size());
+        fprintf(stderr, "lz: %zu bytes of level details to %zu\n", input.size(), compressed.size());
+
+        runner.run("lz/compress", static_cast<double>(input.size()), [&](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; ++i)
+                keep(lz_compress(input).size());
+        });
+
+        runner.run("lz/decompress", static_cast<double>(input.size()), [&](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; ++i)
+                keep(lz_decompress(compressed, output));
+        });
+
+        return mismatches;
+    }
+
+    std::unique_ptr<PeakPyramid> load_waveform(ThreadPool& pool, std::filesystem::path const& track) {
+        WaveformCache waveforms(pool);
+        waveforms.open(track);
+        while (!waveforms.poll()) bench_wait();
+
+        auto pyramid = std::make_unique<PeakPyramid>();
+        if (PeakPyramid const* loaded = waveforms.pyramid()) {
+            std::span<PeakBin const> const base = loaded->level(0);
+            pyramid->assign(loaded->sample_rate(), loaded->frames(), { base.begin(), base.end() });
+        }
+        return pyramid;
+    }
+
+    // A float wav decodes to exactly the samples written, so the ranged decode has to match one reduce over all of them
+    size_t bench_waveform(Runner& runner, Fixture const& fixture) {
+        constexpr uint32_t kSampleRate = 48000;
+        std::vector<float> samples(static_cast<size_t>(kSampleRate) * 90 + 1000);
+        std::mt19937 random(7);
+        std::uniform_real_distribution<float> noise(-0.1f, 0.1f);
+        for (size_t i = 0; i < samples.size(); ++i)
+            samples[i] = 0.8f * std::sin(static_cast<float>(i) * 0.01f) * std::sin(static_cast<float>(i) * 0.00001f) + noise(random);
+
+        // Also the reference for the decode check, filled even when the reduce benchmark is filtered out
+        std::vector<PeakBin> base((samples.size() + PeakPyramid::kBaseBinFrames - 1) / PeakPyramid::kBaseBinFrames);
+        reduce_peaks(samples.data(), samples.size(), base.data());
+
+        runner.run("waveform/reduce", static_cast<double>(samples.size() * sizeof(float)), [&](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; ++i) {
+                reduce_peaks(samples.data(), samples.size(), base.data());
+                keep(static_cast<uint64_t>(base.back().max));
+            }
+        });
+
+        runner.run("waveform/pyramid", 0.0, [&](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; ++i) {
+                PeakPyramid pyramid;
+                pyramid.assign(kSampleRate, samples.size(), base);
+                keep(pyramid.level_count());
+            }
+        });
+
+        std::filesystem::path const track = fixture.root() / "track.wav";
+        ma_encoder_config const config = ma_encoder_config_init(ma_encoding_format_wav, ma_format_f32, 1, kSampleRate);
+        ma_encoder encoder;
+        if (ma_encoder_init_file(path_to_string(track).c_str(), &config, &encoder) != MA_SUCCESS) return 1;
+        ma_encoder_write_pcm_frames(&encoder, samples.data(), samples.size(), nullptr);
+        ma_encoder_uninit(&encoder);
+
+        ThreadPool pool;
+        set_wake_handler(&bench_wake);
+
+        std::filesystem::path cache = track;
+        cache += kPeakCacheSuffix;
+
+        size_t mismatches = 0;
+        for (bool cached : { false, true }) {
+            auto const pyramid = load_waveform(pool, track);
+            std::span<PeakBin const> const decoded = pyramid->level_count() > 0 ? pyramid->level(0) : std::span<PeakBin const>();
+            if (pyramid->frames() != samples.size() || !std::equal(decoded.begin(), decoded.end(), base.begin(), base.end(), [](PeakBin const& a, PeakBin const& b) { return a.min == b.min && a.max == b.max && a.rms == b.rms; })) {
+                fprintf(stderr, "waveform: %s peaks differ from one reduce over the samples\n", cached ? "cached" : "decoded");
+                ++mismatches;
+            }
+        }
+
+        runner.run("waveform/decode", 0.0, [&](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; ++i) {
+                std::filesystem::remove(cache);
+                keep(load_waveform(pool, track)->frames());
+            }
+        });
+
+        load_waveform(pool, track);
+        runner.run("waveform/cached", 0.0, [&](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; ++i)
+                keep(load_waveform(pool, track)->frames());
+        });
+
+        // The last cache write may still be running
+        drain(pool);
+        set_wake_handler(nullptr);
+        return mismatches;
+    }
+
+#ifdef TE_PROFILER
+    // Cost of one zone on an already registered thread, paid by every instrumented scope in debug builds
+    void bench_profiler(Runner& runner) {
+        runner.run("profiler/zone", 0.0, [&](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; ++i) {
+                TE_PROFILE_ZONE("Bench Zone");
+                keep(i);
+            }
+        });
+    }
+#endif
+
+    void bench_image(Runner& runner, Options const& options) {
+        std::error_code ec;
+        uintmax_t const size = std::filesystem::file_size(options.imagePath, ec);
+        if (ec) {
+            fprintf(stderr, "skipping image benchmarks, %s not found\n", options.imagePath.c_str());
+            return;
+        }
+
+        runner.run("image/stbi_load", static_cast<double>(size), [&](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; ++i) {
+                Image image(options.imagePath.c_str());
+                keep(reinterpret_cast<uintptr_t>(image.pixels()));
+            }
+        });
+
+        Image a(options.imagePath.c_str());
+        Image b(options.imagePath.c_str());
+
+        runner.run("image/move", 0.0, [&](uint64_t iterations) {
+            for (uint64_t i = 0; i < iterations; ++i) {
+                Image temp(std::move(a));
+                a = std::move(b);
+                b = std::move(temp);
+                keep(reinterpret_cast<uintptr_t>(a.pixels()));
+            }
+        });
+    }
+
+    std::string to_json(std::vector<Result> const& results) {
+        std::string out = "{\"isa\":\"";
+        out += hash32_isa_name(hash32_detect_isa());
+        out += "\",\"threads\":" + std::to_string(std::thread::hardware_concurrency()) + ",\"benchmarks\":[\n";
+
+        for (size_t i = 0; i < results.size(); ++i) {
+            Result const& result = results[i];
+
+            // One benchmark per line, `load_baseline` relies on it
+            char line[512];
+            snprintf(line, sizeof(line),
+                "{\"name\":\"%s\",\"samples\":%zu,\"iterations\":%llu,\"min_ns\":%.3f,\"median_ns\":%.3f,\"p90_ns\":%.3f,\"p99_ns\":%.3f,\"mad_ns\":%.3f,\"bytes_per_op\":%.0f}%s\n",
+                result.name.c_str(), result.samples, static_cast<unsigned long long>(result.iterations), result.minNs, result.medianNs, result.p90Ns, result.p99Ns, result.madNs, result.bytesPerOp,
+                i + 1 < results.size() ? "," : "");
+            out += line;
+        }
+
+        out += "]}\n";
+        return out;
+    }
+
+    std::optional<std::string_view> json_field(std::string_view line, std::string_view key) {
+        std::string const pattern = "\"" + std::string(key) + "\":";
+        size_t begin = line.find(pattern);
+        if (begin == std::string_view::npos) return std::nullopt;
+        begin += pattern.size();
+
+        if (begin < line.size() && line[begin] == '"') {
+            size_t const end = line.find('"', begin + 1);
+            if (end == std::string_view::npos) return std::nullopt;
+            return line.substr(begin + 1, end - begin - 1);
+        }
+
+        size_t const end = line.find_first_of(",}", begin);
+        return line.substr(begin, end == std::string_view::npos ? std::string_view::npos : end - begin);
+    }
+
+    // Benchmark name to median, reads the files `to_json` writes
+    std::optional<std::unordered_map<std::string, double>> load_baseline(std::string const& path) {
+        std::ifstream file(path, std::ios::in | std::ios::binary);
+        if (!file) return std::nullopt;
+
+        std::unordered_map<std::string, double> medians;
+        std::string line;
+        while (std::getline(file, line)) {
+            auto const name = json_field(line, "name");
+            auto const median = json_field(line, "median_ns");
+            if (!name || !median) continue;
+
+            double value = 0.0;
+            if (std::from_chars(median->data(), median->data() + median->size(), value).ec == std::errc())
+                medians.emplace(std::string(*name), value);
+        }
+
+        return medians;
+    }
+
+    // Returns the number of benchmarks slower than the baseline by more than the threshold
+    size_t compare(std::vector<Result> const& results, std::unordered_map<std::string, double> const& baseline, double threshold) {
+        size_t regressions = 0;
+
+        fprintf(stderr, "\n%-32s %12s %12s %9s\n", "benchmark", "baseline", "current", "change");
+        for (Result const& result : results) {
+            auto it = baseline.find(result.name);
+            if (it == baseline.end()) {
+                fprintf(stderr, "%-32s %12s %12.1f %9s\n", result.name.c_str(), "-", result.medianNs, "new");
+                continue;
+            }
+
+            double const change = (result.medianNs / it->second - 1.0) * 100.0;
+            bool const regressed = change > threshold;
+            regressions += regressed;
+
+            fprintf(stderr, "%-32s %12.1f %12.1f %+8.1f%%%s\n", result.name.c_str(), it->second, result.medianNs, change, regressed ? "  REGRESSION" : "");
+        }
+
+        return regressions;
+    }
+
+    int usage() {
+        fputs(
+            "usage: thumper_bench [options]\n"
+            "\n"
+            "  --filter text        only run benchmarks whose name contains text\n"
+            "  --json path          write results as json, - for stdout\n"
+            "  --baseline path      compare against an earlier --json output, exits with 1 on regressions\n"
+            "  --threshold percent  slowdown of the median that counts as a regression, default 10\n"
+            "  --image path         image decoded by the image benchmarks, default diff.png\n"
+            "  --min-time seconds   least time spent sampling each benchmark, default 0.5\n"
+            "  --levels path        level library the fast details parser is checked against yaml-cpp on, default levels\n",
+            stderr
+        );
+        return kExitUsage;
+    }
+
+    std::optional<Options> parse_options(int argc, char** argv) {
+        Options options;
+
+        for (int i = 1; i < argc; ++i) {
+            std::string_view const arg = argv[i];
+            if (i + 1 >= argc) return std::nullopt;
+            std::string_view const value = argv[++i];
+
+            if (arg == "--filter") options.filter = value;
+            else if (arg == "--json") options.jsonPath = value;
+            else if (arg == "--baseline") options.baselinePath = value;
+            else if (arg == "--image") options.imagePath = value;
+            else if (arg == "--levels") options.levelsPath = value;
+            else if (arg == "--threshold") options.threshold = std::strtod(std::string(value).c_str(), nullptr);
+            else if (arg == "--min-time") options.minSeconds = std::strtod(std::string(value).c_str(), nullptr);
+            else return std::nullopt;
+        }
+
+        return options;
+    }
+}
+
+int main(int argc, char** argv) {
+    auto options = parse_options(argc, argv);
+    if (!options) return usage();
+
+    Runner runner(*options);
+
+    // Timings of a parser that disagrees with yaml-cpp are meaningless, checked before anything runs
+    size_t mismatches = check_level_details(options->levelsPath);
+    mismatches += check_hash32();
+
+    bench_hash(runner);
+    {
+        Fixture fixture;
+        mismatches += check_level_details(fixture.levels());
+        bench_levels(runner, fixture);
+        bench_snapshot(runner, fixture);
+        mismatches += bench_pack(runner, fixture);
+        mismatches += bench_waveform(runner, fixture);
+    }
+#ifdef TE_PROFILER
+    bench_profiler(runner);
+#endif
+    bench_image(runner, *options);
+
+    std::string const json = to_json(runner.results());
+    if (options->jsonPath == "-") {
+        fwrite(json.data(), 1, json.size(), stdout);
+    }
+    else if (!options->jsonPath.empty()) {
+        std::ofstream file(options->jsonPath, std::ios::out | std::ios::binary);
+        file << json;
+    }
+
+    if (mismatches > 0) return EXIT_FAILURE;
+
+    if (!options->baselinePath.empty()) {
+        auto baseline = load_baseline(options->baselinePath);
+        if (!baseline) {
+            fprintf(stderr, "could not read %s\n", options->baselinePath.c_str());
+            return EXIT_FAILURE;
+        }
+
+        if (compare(runner.results(), *baseline, options->threshold) > 0) return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
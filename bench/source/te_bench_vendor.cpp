@@ -0,0 +1,8 @@
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#define STB_VORBIS_HEADER_ONLY
+#include <stb_vorbis.c>
+
+#define MINIAUDIO_IMPLEMENTATION
+#include <miniaudio.h>
@@ -1,3 +1,15 @@
+-- The known name table is compiled from a plain list, turned into an include on every premake run
+do
+	local lines = { "// Generated by editor/build.lua from te_known_names.txt, edit the list instead" }
+	for line in io.lines(_SCRIPT_DIR .. "/source/te_known_names.txt") do
+		local name = line:match("^%s*(.-)%s*$")
+		if name ~= "" and not name:match("^#") then
+			table.insert(lines, "\"" .. (name:gsub("[\\\"]", "\\%0")) .. "\",")
+		end
+	end
+	os.writefile_ifnotequal(table.concat(lines, "\n") .. "\n", _SCRIPT_DIR .. "/source/te_known_names.inc")
+end
+
 project "thumper_editor"
 debugdir "../working"
 kind "ConsoleApp"
@@ -0,0 +1,210 @@
+#include "te_audio.hpp"
+#include "te_profiler.hpp"
+#include "te_util.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+void AudioEngine::init(AudioConfig const& config) {
+    TE_PROFILE_ZONE("Audio Init");
+
+    mConfig = config;
+
+    ma_context_init(nullptr, 0, nullptr, &mContext);
+
+    ma_device_config deviceConfig = ma_device_config_init(ma_device_type_playback);
+    deviceConfig.playback.format = ma_format_f32;
+    deviceConfig.periodSizeInFrames = config.periodSizeInFrames;
+    deviceConfig.periods = config.periods;
+    deviceConfig.performanceProfile = ma_performance_profile_low_latency;
+    deviceConfig.dataCallback = &AudioEngine::data_callback;
+    deviceConfig.pUserData = this;
+
+    ma_device_init(&mContext, &deviceConfig, &mDevice);
+
+    ma_engine_config engineConfig = ma_engine_config_init();
+    engineConfig.pDevice = &mDevice;
+
+    ma_engine_init(&engineConfig, &mEngine);
+
+    // Started last, the callback reads from the engine
+    ma_device_start(&mDevice);
+}
+
+void AudioEngine::uninit() {
+    stop_stream();
+
+    ma_device_stop(&mDevice);
+    ma_engine_uninit(&mEngine);
+    ma_device_uninit(&mDevice);
+    ma_context_uninit(&mContext);
+}
+
+void AudioEngine::play_sound(char const* path) {
+    ma_engine_play_sound(&mEngine, path, nullptr);
+}
+
+void AudioEngine::data_callback(ma_device* device, void* output, void const*, ma_uint32 frameCount) {
+    TE_PROFILE_THREAD("Audio");
+    TE_PROFILE_ZONE("Audio Callback");
+
+    auto const start = std::chrono::steady_clock::now();
+
+    AudioEngine* self = static_cast<AudioEngine*>(device->pUserData);
+    ma_engine_read_pcm_frames(&self->mEngine, output, frameCount, nullptr);
+    self->mix_stream(static_cast<float*>(output), frameCount);
+
+    uint32_t const elapsed = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+    self->mCallbacks.fetch_add(1, std::memory_order_relaxed);
+    self->mCallbackNanoseconds.fetch_add(elapsed, std::memory_order_relaxed);
+    self->mLastCallbackNanoseconds.store(elapsed, std::memory_order_relaxed);
+    if (elapsed > self->mMaxCallbackNanoseconds.load(std::memory_order_relaxed))
+        self->mMaxCallbackNanoseconds.store(elapsed, std::memory_order_relaxed);
+}
+
+void AudioEngine::mix_stream(float* output, ma_uint32 frameCount) {
+    // Paired with `stop_stream`, which clears the active flag and then waits for this one to drop
+    mCallbackBusy.store(true);
+    if (!mStreamActive.load()) {
+        mCallbackBusy.store(false);
+        return;
+    }
+
+    ma_uint32 const channels = mDevice.playback.channels;
+    ma_uint32 remaining = frameCount;
+
+    while (remaining > 0) {
+        ma_uint32 frames = remaining;
+        void* region;
+        if (ma_pcm_rb_acquire_read(&mRing, &frames, &region) != MA_SUCCESS || frames == 0) break;
+
+        float const* samples = static_cast<float const*>(region);
+        for (ma_uint32 i = 0; i < frames * channels; ++i)
+            output[i] += samples[i];
+
+        ma_pcm_rb_commit_read(&mRing, frames);
+        output += frames * channels;
+        remaining -= frames;
+        mFramesPlayed.fetch_add(frames, std::memory_order_relaxed);
+    }
+
+    if (remaining > 0 && !mStreamDecoded.load(std::memory_order_acquire))
+        mUnderruns.fetch_add(1, std::memory_order_relaxed);
+
+    mCallbackBusy.store(false);
+}
+
+bool AudioEngine::play_stream(std::filesystem::path const& path) {
+    TE_PROFILE_ZONE("Audio Open Stream");
+
+    stop_stream();
+
+    ma_decoder_config const decoderConfig = ma_decoder_config_init(ma_format_f32, mDevice.playback.channels, mDevice.sampleRate);
+#ifdef TE_WINDOWS
+    ma_result const result = ma_decoder_init_file_w(path.c_str(), &decoderConfig, &mDecoder);
+#else
+    ma_result const result = ma_decoder_init_file(path.c_str(), &decoderConfig, &mDecoder);
+#endif
+    if (result != MA_SUCCESS) return false;
+
+    ma_uint32 const capacity = static_cast<ma_uint32>(static_cast<uint64_t>(mDevice.sampleRate) * mConfig.streamBufferMs / 1000);
+    if (ma_pcm_rb_init(ma_format_f32, mDevice.playback.channels, capacity, nullptr, nullptr, &mRing) != MA_SUCCESS) {
+        ma_decoder_uninit(&mDecoder);
+        return false;
+    }
+
+    ma_uint64 length = 0;
+    ma_decoder_get_length_in_pcm_frames(&mDecoder, &length);
+
+    mStreamLength = length;
+    mStreamName = path_to_string(path.filename());
+    mStreamOpen = true;
+    mFramesPlayed = 0;
+    mStreamDecoded = false;
+    mStopDecode = false;
+
+    mDecodeThread = std::thread(&AudioEngine::decode_stream, this);
+    return true;
+}
+
+void AudioEngine::decode_stream() {
+    TE_PROFILE_THREAD("Audio Decode");
+
+    // Small writes keep the ring topped up close to the read position
+    ma_uint32 const chunk = mDevice.playback.internalPeriodSizeInFrames > 0 ? mDevice.playback.internalPeriodSizeInFrames : 512;
+    auto const idle = std::chrono::milliseconds(std::max<uint32_t>(mConfig.streamBufferMs / 8, 1));
+
+    while (!mStopDecode.load(std::memory_order_relaxed)) {
+        ma_uint32 frames = chunk;
+        void* region;
+        if (ma_pcm_rb_acquire_write(&mRing, &frames, &region) != MA_SUCCESS || frames == 0) {
+            // Full, playback starts once the ring has been primed the first time
+            mStreamActive.store(true);
+            std::this_thread::sleep_for(idle);
+            continue;
+        }
+
+        TE_PROFILE_ZONE("Audio Decode Chunk");
+        ma_uint64 decoded = 0;
+        ma_decoder_read_pcm_frames(&mDecoder, region, frames, &decoded);
+        ma_pcm_rb_commit_write(&mRing, static_cast<ma_uint32>(decoded));
+
+        if (decoded < frames) {
+            mStreamDecoded.store(true, std::memory_order_release);
+            mStreamActive.store(true);
+            break;
+        }
+    }
+}
+
+void AudioEngine::stop_stream() {
+    if (!mStreamOpen) return;
+
+    mStopDecode = true;
+    if (mDecodeThread.joinable()) mDecodeThread.join();
+
+    mStreamActive.store(false);
+    while (mCallbackBusy.load())
+        std::this_thread::yield();
+
+    ma_pcm_rb_uninit(&mRing);
+    ma_decoder_uninit(&mDecoder);
+    mStreamOpen = false;
+    mStreamName.clear();
+}
+
+bool AudioEngine::streaming() const {
+    if (!mStreamOpen) return false;
+    if (!mStreamDecoded.load(std::memory_order_acquire)) return true;
+    return ma_pcm_rb_available_read(const_cast<ma_pcm_rb*>(&mRing)) > 0;
+}
+
+double AudioEngine::stream_position() const {
+    return mDevice.sampleRate > 0 ? static_cast<double>(mFramesPlayed.load(std::memory_order_relaxed)) / mDevice.sampleRate : 0.0;
+}
+
+double AudioEngine::stream_length() const {
+    return mDevice.sampleRate > 0 ? static_cast<double>(mStreamLength) / mDevice.sampleRate : 0.0;
+}
+
+AudioEngine::Stats AudioEngine::stats() const {
+    Stats stats;
+    stats.callbacks = mCallbacks.load(std::memory_order_relaxed);
+    stats.underruns = mUnderruns.load(std::memory_order_relaxed);
+    stats.lastCallbackUs = static_cast<float>(mLastCallbackNanoseconds.load(std::memory_order_relaxed)) / 1e3f;
+    stats.maxCallbackUs = static_cast<float>(mMaxCallbackNanoseconds.load(std::memory_order_relaxed)) / 1e3f;
+    if (stats.callbacks > 0)
+        stats.averageCallbackUs = static_cast<float>(static_cast<double>(mCallbackNanoseconds.load(std::memory_order_relaxed)) / static_cast<double>(stats.callbacks) / 1e3);
+
+    stats.sampleRate = mDevice.sampleRate;
+    stats.periodSizeInFrames = mDevice.playback.internalPeriodSizeInFrames;
+    stats.periods = mDevice.playback.internalPeriods;
+
+    if (mStreamOpen) {
+        ma_pcm_rb* ring = const_cast<ma_pcm_rb*>(&mRing);
+        stats.bufferedFrames = ma_pcm_rb_available_read(ring);
+        stats.bufferCapacity = ma_pcm_rb_get_subbuffer_size(ring);
+    }
+
+    return stats;
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <miniaudio.h>
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <thread>
+
+struct AudioConfig {
+    // Zero leaves the choice to the backend
+    uint32_t periodSizeInFrames = 0;
+    uint32_t periods = 0;
+
+    // Decoded audio kept ahead of the device while streaming, this is all a track ever holds in memory
+    uint32_t streamBufferMs = 250;
+};
+
+// Playback device shared by the ui sounds and one streamed preview. Short sounds go through
+// the miniaudio engine, a preview is decoded on its own thread into a fixed size lock free
+// ring buffer that the device callback mixes in, so any length of track costs the same memory.
+class AudioEngine final {
+public:
+    struct Stats {
+        uint64_t callbacks = 0;
+        // Callbacks that found the stream's ring buffer short before the track ended
+        uint64_t underruns = 0;
+        float lastCallbackUs = 0.0f;
+        float averageCallbackUs = 0.0f;
+        float maxCallbackUs = 0.0f;
+
+        uint32_t sampleRate = 0;
+        uint32_t periodSizeInFrames = 0;
+        uint32_t periods = 0;
+
+        uint32_t bufferedFrames = 0;
+        uint32_t bufferCapacity = 0;
+    };
+
+    AudioEngine() = default;
+    ~AudioEngine() noexcept = default;
+
+    AudioEngine(AudioEngine const&) = delete;
+    AudioEngine& operator=(AudioEngine const&) = delete;
+
+    void init(AudioConfig const& config = {});
+    void uninit();
+
+    // Fire and forget, the whole file is decoded up front
+    void play_sound(char const* path);
+
+    // Replaces any stream already playing, false if the file cannot be decoded
+    bool play_stream(std::filesystem::path const& path);
+    void stop_stream();
+
+    // True until the stream has played out or was stopped
+    bool streaming() const;
+    inline std::string const& stream_name() const { return mStreamName; }
+    double stream_position() const;
+    double stream_length() const;
+
+    Stats stats() const;
+private:
+    static void data_callback(ma_device* device, void* output, void const* input, ma_uint32 frameCount);
+    void mix_stream(float* output, ma_uint32 frameCount);
+    void decode_stream();
+
+    AudioConfig mConfig;
+
+    ma_context mContext;
+    ma_device mDevice;
+    ma_engine mEngine;
+
+    ma_decoder mDecoder;
+    ma_pcm_rb mRing;
+    std::thread mDecodeThread;
+    std::string mStreamName;
+    uint64_t mStreamLength = 0;
+    bool mStreamOpen = false;
+
+    // Set by the decode thread once the ring is primed, read by the device callback
+    std::atomic<bool> mStreamActive = false;
+    std::atomic<bool> mStreamDecoded = false;
+    std::atomic<bool> mStopDecode = false;
+    // Raised around the callback's use of the ring so `stop_stream` can wait it out
+    std::atomic<bool> mCallbackBusy = false;
+    std::atomic<uint64_t> mFramesPlayed = 0;
+
+    std::atomic<uint64_t> mCallbacks = 0;
+    std::atomic<uint64_t> mUnderruns = 0;
+    std::atomic<uint64_t> mCallbackNanoseconds = 0;
+    std::atomic<uint32_t> mLastCallbackNanoseconds = 0;
+    std::atomic<uint32_t> mMaxCallbackNanoseconds = 0;
+};
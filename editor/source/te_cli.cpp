@@ -0,0 +1,559 @@
+#include "te_cli.hpp"
+#include "te_deploy.hpp"
+#include "te_hash.hpp"
+#include "te_level.hpp"
+#include "te_level_pack.hpp"
+#include "te_thread_pool.hpp"
+#include "te_util.hpp"
+
+#include <yaml-cpp/yaml.h>
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+    constexpr int kExitUsage = 2;
+
+    using Clock = std::chrono::steady_clock;
+
+    std::mutex gWakeMutex;
+    std::condition_variable gWakeCondition;
+    bool gWoken = false;
+
+    // Stands in for the glfw event loop while a library scan runs headless
+    void cli_wake() {
+        {
+            std::lock_guard lock(gWakeMutex);
+            gWoken = true;
+        }
+        gWakeCondition.notify_all();
+    }
+
+    void cli_wait() {
+        std::unique_lock lock(gWakeMutex);
+        gWakeCondition.wait_for(lock, std::chrono::milliseconds(100), []() { return gWoken; });
+        gWoken = false;
+    }
+
+    void append_json_string(std::string& out, std::string_view value) {
+        out += '"';
+        for (char c : value) {
+            switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char escape[8];
+                    snprintf(escape, sizeof(escape), "\\u%04x", c);
+                    out += escape;
+                }
+                else {
+                    out += c;
+                }
+            }
+        }
+        out += '"';
+    }
+
+    void append_json_hash(std::string& out, uint32_t hash) {
+        char hex[16];
+        snprintf(hex, sizeof(hex), "\"%08x\"", hash);
+        out += hex;
+    }
+
+    struct Arguments {
+        std::vector<std::string_view> positional;
+        std::vector<std::pair<std::string_view, std::string_view>> options;
+        bool stats = false;
+
+        std::optional<std::string_view> option(std::string_view name) const {
+            for (auto const& [key, value] : options)
+                if (key == name) return value;
+            return std::nullopt;
+        }
+    };
+
+    // `--name value` pairs, `--stats` is the only flag without a value
+    std::optional<Arguments> parse_arguments(int argc, char** argv, int first) {
+        Arguments arguments;
+
+        for (int i = first; i < argc; ++i) {
+            std::string_view const arg = argv[i];
+
+            if (arg == "--stats") {
+                arguments.stats = true;
+            }
+            else if (arg.starts_with("--")) {
+                if (i + 1 >= argc) {
+                    fprintf(stderr, "missing value for %s\n", argv[i]);
+                    return std::nullopt;
+                }
+                arguments.options.emplace_back(arg.substr(2), argv[++i]);
+            }
+            else {
+                arguments.positional.push_back(arg);
+            }
+        }
+
+        return arguments;
+    }
+
+    unsigned int thread_option(Arguments const& arguments) {
+        unsigned int threads = 0;
+        if (auto value = arguments.option("threads"))
+            std::from_chars(value->data(), value->data() + value->size(), threads);
+        return threads;
+    }
+
+    void print_stats(char const* command, size_t count, Clock::time_point start) {
+        double const seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        fprintf(stderr, "{\"command\":\"%s\",\"count\":%zu,\"ms\":%.3f,\"per_second\":%.1f}\n", command, count, seconds * 1e3, seconds > 0.0 ? count / seconds : 0.0);
+    }
+
+    int usage() {
+        fputs(
+            "usage: thumper_editor <command> [options]\n"
+            "\n"
+            "commands:\n"
+            "  hash [--isa scalar|sse41|avx2] [--threads N] [name...]\n"
+            "      hash names, read one per line from stdin when none are given\n"
+            "  lookup [--dictionary hash_dictionary.txt] hash...\n"
+            "      resolve hashes to known names\n"
+            "  scan [--root levels] [--index level_index.bin]\n"
+            "      list every level in the library, --index reuses and updates a snapshot\n"
+            "  validate level_dir...\n"
+            "      check level details, exits with 1 if any level is invalid\n"
+            "  deploy [--source levels] --destination thumper_dir/levels\n"
+            "      copy changed level files into the game, exits with 1 on any error\n"
+            "  pack [--root levels] [--compression lz|none] --output levels.tepack\n"
+            "      write every level into one pack, exits with 1 if any level was left out\n"
+            "  unpack [--root levels] pack\n"
+            "      extract a pack's levels, replacing levels with the same directory name\n"
+            "  pack-list pack\n"
+            "      list a pack's levels and files without reading their contents\n"
+            "\n"
+            "every command writes one json object per line, --stats adds timings on stderr\n",
+            stderr
+        );
+        return kExitUsage;
+    }
+
+    int command_hash(Arguments const& arguments) {
+        auto const start = Clock::now();
+
+        std::vector<std::string> storage;
+        std::vector<std::string_view> names;
+
+        if (arguments.positional.empty()) {
+            std::string line;
+            while (std::getline(std::cin, line)) {
+                if (!line.empty() && line.back() == '\r') line.pop_back();
+                storage.emplace_back(std::move(line));
+            }
+            names.assign(storage.begin(), storage.end());
+        }
+        else {
+            names = arguments.positional;
+        }
+
+        std::vector<uint32_t> hashes(names.size());
+
+        if (auto isa = arguments.option("isa")) {
+            HashIsa selected = HashIsa::Scalar;
+            if (*isa == "avx2") selected = HashIsa::Avx2;
+            else if (*isa == "sse41") selected = HashIsa::Sse41;
+            else if (*isa != "scalar") return usage();
+
+            if (static_cast<int>(selected) > static_cast<int>(hash32_detect_isa())) {
+                fprintf(stderr, "%s is not supported on this machine\n", hash32_isa_name(selected));
+                return EXIT_FAILURE;
+            }
+
+            hash32_batch(names, hashes, selected);
+        }
+        else {
+            hash32_batch_parallel(names, hashes, thread_option(arguments));
+        }
+
+        std::string out;
+        for (size_t i = 0; i < names.size(); ++i) {
+            out += "{\"name\":";
+            append_json_string(out, names[i]);
+            out += ",\"hash\":";
+            append_json_hash(out, hashes[i]);
+            out += "}\n";
+
+            if (out.size() > 64 * 1024) {
+                fwrite(out.data(), 1, out.size(), stdout);
+                out.clear();
+            }
+        }
+        fwrite(out.data(), 1, out.size(), stdout);
+
+        if (arguments.stats) print_stats("hash", names.size(), start);
+        return EXIT_SUCCESS;
+    }
+
+    int command_lookup(Arguments const& arguments) {
+        auto const start = Clock::now();
+
+        HashDictionary dictionary;
+        std::string const path(arguments.option("dictionary").value_or("hash_dictionary.txt"));
+        if (!dictionary.load(path)) {
+            fprintf(stderr, "could not read %s\n", path.c_str());
+            return EXIT_FAILURE;
+        }
+
+        std::string out;
+        for (auto text : arguments.positional) {
+            auto const parsed = parse_hash32(text);
+            if (!parsed) {
+                fprintf(stderr, "not a hash: %.*s\n", static_cast<int>(text.size()), text.data());
+                return kExitUsage;
+            }
+
+            uint32_t const hash = *parsed;
+
+            out += "{\"hash\":";
+            append_json_hash(out, hash);
+            out += ",\"names\":[";
+            bool first = true;
+            for (auto name : dictionary.find(hash)) {
+                if (!first) out += ',';
+                append_json_string(out, name);
+                first = false;
+            }
+            out += "]}\n";
+        }
+        fwrite(out.data(), 1, out.size(), stdout);
+
+        if (arguments.stats) print_stats("lookup", arguments.positional.size(), start);
+        return EXIT_SUCCESS;
+    }
+
+    int command_scan(Arguments const& arguments) {
+        auto const start = Clock::now();
+
+        std::string const root(arguments.option("root").value_or("levels"));
+        // Runs in parallel would race on a shared snapshot, it is only used when asked for
+        std::string const index(arguments.option("index").value_or(""));
+
+        set_wake_handler(&cli_wake);
+
+        LevelList levels;
+        {
+            ThreadPool pool(thread_option(arguments));
+            LevelLibrary library(pool, root, index);
+            library.scan();
+
+            while (library.scanning()) {
+                cli_wait();
+                library.poll();
+            }
+
+            levels = library.levels();
+        }
+
+        set_wake_handler(nullptr);
+
+        std::vector<uint32_t> order(levels.size());
+        for (size_t i = 0; i < order.size(); ++i)
+            order[i] = static_cast<uint32_t>(i);
+        std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return levels[a].path < levels[b].path; });
+
+        std::string out;
+        for (uint32_t index : order) {
+            LevelView const level = levels[index];
+            out += "{\"path\":";
+            append_json_string(out, level.path);
+            out += ",\"name\":";
+            append_json_string(out, level.name);
+            out += ",\"difficulty\":";
+            append_json_string(out, level.difficulty);
+            out += ",\"description\":";
+            append_json_string(out, level.description);
+            out += ",\"author\":";
+            append_json_string(out, level.author);
+            out += "}\n";
+        }
+        fwrite(out.data(), 1, out.size(), stdout);
+
+        if (arguments.stats) print_stats("scan", levels.size(), start);
+        return EXIT_SUCCESS;
+    }
+
+    std::vector<std::string> validate_level(std::filesystem::path const& directory) {
+        std::vector<std::string> errors;
+
+        std::error_code ec;
+        if (!std::filesystem::is_directory(directory, ec)) {
+            errors.emplace_back("not a directory");
+            return errors;
+        }
+
+        std::filesystem::path const details = directory / "LEVEL DETAILS.txt";
+        if (!std::filesystem::is_regular_file(details, ec)) {
+            errors.emplace_back("missing LEVEL DETAILS.txt");
+            return errors;
+        }
+
+        YAML::Node root;
+        try {
+            root = YAML::LoadFile(path_to_string(details));
+        }
+        catch (YAML::Exception const& e) {
+            errors.emplace_back(e.what());
+            return errors;
+        }
+
+        if (!root.IsMap()) {
+            errors.emplace_back("LEVEL DETAILS.txt is not a mapping");
+            return errors;
+        }
+
+        struct Field {
+            char const* key;
+            bool required;
+        };
+
+        constexpr Field kFields[] = {
+            { "level_name", true },
+            { "difficulty", true },
+            { "description", false },
+            { "author", true },
+        };
+
+        for (auto const& field : kFields) {
+            YAML::Node const node = root[field.key];
+
+            if (!node) errors.emplace_back(std::string("missing key ") + field.key);
+            else if (!node.IsScalar()) errors.emplace_back(std::string(field.key) + " is not a string");
+            else if (field.required && node.Scalar().empty()) errors.emplace_back(std::string(field.key) + " is empty");
+        }
+
+        return errors;
+    }
+
+    int command_validate(Arguments const& arguments) {
+        auto const start = Clock::now();
+        if (arguments.positional.empty()) return usage();
+
+        std::vector<std::vector<std::string>> results(arguments.positional.size());
+
+        {
+            ThreadPool pool(thread_option(arguments));
+            std::atomic<size_t> remaining = results.size();
+
+            for (size_t i = 0; i < results.size(); ++i) {
+                pool.submit([&, i]() {
+                    results[i] = validate_level(std::filesystem::path(arguments.positional[i]));
+                    if (remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) cli_wake();
+                });
+            }
+
+            while (remaining.load(std::memory_order_acquire) > 0)
+                cli_wait();
+        }
+
+        bool valid = true;
+        std::string out;
+        for (size_t i = 0; i < results.size(); ++i) {
+            valid &= results[i].empty();
+
+            out += "{\"path\":";
+            append_json_string(out, arguments.positional[i]);
+            out += results[i].empty() ? ",\"valid\":true,\"errors\":[" : ",\"valid\":false,\"errors\":[";
+            for (size_t e = 0; e < results[i].size(); ++e) {
+                if (e > 0) out += ',';
+                append_json_string(out, results[i][e]);
+            }
+            out += "]}\n";
+        }
+        fwrite(out.data(), 1, out.size(), stdout);
+
+        if (arguments.stats) print_stats("validate", results.size(), start);
+        return valid ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    int command_deploy(Arguments const& arguments) {
+        auto const destination = arguments.option("destination");
+        if (!destination) return usage();
+
+        set_wake_handler(&cli_wake);
+
+        LevelDeployer::Report report;
+        {
+            ThreadPool pool(thread_option(arguments));
+            LevelDeployer deployer(pool);
+            deployer.start(std::string(arguments.option("source").value_or("levels")), std::string(*destination));
+
+            while (!deployer.poll())
+                cli_wait();
+
+            report = *deployer.report();
+        }
+
+        set_wake_handler(nullptr);
+
+        std::string out;
+        for (auto const& error : report.errors) {
+            out += "{\"error\":";
+            append_json_string(out, error);
+            out += "}\n";
+        }
+
+        char summary[256];
+        snprintf(summary, sizeof(summary), "{\"files\":%zu,\"copied\":%zu,\"skipped\":%zu,\"removed\":%zu,\"bytes\":%llu}\n",
+            report.files, report.copied, report.skipped, report.removed, static_cast<unsigned long long>(report.bytesCopied));
+        out += summary;
+        fwrite(out.data(), 1, out.size(), stdout);
+
+        if (arguments.stats) fprintf(stderr, "{\"command\":\"deploy\",\"count\":%zu,\"ms\":%.3f}\n", report.files, report.seconds * 1e3);
+        return report.errors.empty() ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    int print_pack_report(char const* command, Arguments const& arguments, LevelPackReport const& report) {
+        std::string out;
+        for (auto const& error : report.errors) {
+            out += "{\"error\":";
+            append_json_string(out, error);
+            out += "}\n";
+        }
+
+        char summary[256];
+        snprintf(summary, sizeof(summary), "{\"levels\":%zu,\"files\":%zu,\"bytes\":%llu,\"stored_bytes\":%llu}\n",
+            report.levels, report.files, static_cast<unsigned long long>(report.bytes), static_cast<unsigned long long>(report.storedBytes));
+        out += summary;
+        fwrite(out.data(), 1, out.size(), stdout);
+
+        if (arguments.stats) fprintf(stderr, "{\"command\":\"%s\",\"count\":%zu,\"ms\":%.3f}\n", command, report.levels, report.seconds * 1e3);
+        return report.errors.empty() ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    int command_pack(Arguments const& arguments) {
+        auto const output = arguments.option("output");
+        if (!output) return usage();
+
+        auto const compression = arguments.option("compression").value_or("lz");
+        if (compression != "lz" && compression != "none") return usage();
+
+        std::filesystem::path const root(std::string(arguments.option("root").value_or("levels")));
+        std::vector<std::filesystem::path> directories;
+        std::error_code ec;
+        for (auto it = std::filesystem::directory_iterator(root, ec); !ec && it != std::filesystem::directory_iterator(); it.increment(ec)) {
+            if (it->is_directory(ec)) directories.emplace_back(it->path());
+        }
+        std::sort(directories.begin(), directories.end());
+
+        LevelPackReport report;
+        LevelPack::write(std::string(*output), directories, compression == "lz", report);
+        return print_pack_report("pack", arguments, report);
+    }
+
+    int command_unpack(Arguments const& arguments) {
+        if (arguments.positional.size() != 1) return usage();
+
+        LevelPack pack;
+        if (!pack.open(std::string(arguments.positional[0]))) {
+            fprintf(stderr, "not a level pack: %.*s\n", static_cast<int>(arguments.positional[0].size()), arguments.positional[0].data());
+            return EXIT_FAILURE;
+        }
+
+        LevelPackReport report;
+        pack.extract(std::string(arguments.option("root").value_or("levels")), report);
+        return print_pack_report("unpack", arguments, report);
+    }
+
+    int command_pack_list(Arguments const& arguments) {
+        auto const start = Clock::now();
+        if (arguments.positional.size() != 1) return usage();
+
+        LevelPack pack;
+        if (!pack.open(std::string(arguments.positional[0]))) {
+            fprintf(stderr, "not a level pack: %.*s\n", static_cast<int>(arguments.positional[0].size()), arguments.positional[0].data());
+            return EXIT_FAILURE;
+        }
+
+        std::string out;
+        for (size_t index = 0; index < pack.level_count(); ++index) {
+            LevelView const level = pack.level(index);
+            out += "{\"path\":";
+            append_json_string(out, level.path);
+            out += ",\"name\":";
+            append_json_string(out, level.name);
+            out += ",\"difficulty\":";
+            append_json_string(out, level.difficulty);
+            out += ",\"description\":";
+            append_json_string(out, level.description);
+            out += ",\"author\":";
+            append_json_string(out, level.author);
+            out += ",\"files\":[";
+
+            auto const [first, last] = pack.level_entries(index);
+            for (size_t i = first; i < last; ++i) {
+                LevelPack::Entry const entry = pack.entry(i);
+                if (i > first) out += ',';
+                out += "{\"name\":";
+                append_json_string(out, entry.name);
+
+                char sizes[96];
+                snprintf(sizes, sizeof(sizes), ",\"size\":%llu,\"stored_size\":%llu}", static_cast<unsigned long long>(entry.size), static_cast<unsigned long long>(entry.storedSize));
+                out += sizes;
+            }
+            out += "]}\n";
+        }
+        fwrite(out.data(), 1, out.size(), stdout);
+
+        if (arguments.stats) print_stats("pack-list", pack.level_count(), start);
+        return EXIT_SUCCESS;
+    }
+}
+
+std::optional<int> run_cli(int argc, char** argv) {
+    if (argc < 2) return std::nullopt;
+
+    using Command = int (*)(Arguments const&);
+    struct Entry {
+        std::string_view name;
+        Command command;
+    };
+
+    constexpr Entry kCommands[] = {
+        { "hash", &command_hash },
+        { "lookup", &command_lookup },
+        { "scan", &command_scan },
+        { "validate", &command_validate },
+        { "deploy", &command_deploy },
+        { "pack", &command_pack },
+        { "unpack", &command_unpack },
+        { "pack-list", &command_pack_list },
+    };
+
+    std::string_view const name = argv[1];
+    if (name == "help" || name == "--help" || name == "-h") return usage();
+
+    for (auto const& entry : kCommands) {
+        if (entry.name != name) continue;
+
+        auto arguments = parse_arguments(argc, argv, 2);
+        if (!arguments) return usage();
+        return entry.command(*arguments);
+    }
+
+    // Anything else, like a file the shell hands over, is left to the editor as before
+    return std::nullopt;
+}
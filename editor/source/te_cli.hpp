@@ -0,0 +1,9 @@
+#pragma once
+
+#include <optional>
+
+// Runs a headless subcommand when one is named on the command line. Nothing here
+// touches glfw, gl or the audio device so it works on machines without a display.
+// Returns nullopt when the editor should start normally, which is also the case when
+// the first argument is not a known command.
+std::optional<int> run_cli(int argc, char** argv);
@@ -0,0 +1,451 @@
+#include "te_deploy.hpp"
+#include "te_profiler.hpp"
+#include "te_thread_pool.hpp"
+#include "te_util.hpp"
+#include "te_waveform.hpp"
+
+#ifdef TE_LINUX
+#   include <fcntl.h>
+#   include <sys/sendfile.h>
+#   include <sys/stat.h>
+#   include <unistd.h>
+#   include <cerrno>
+#endif
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+    constexpr char kManifestMagic[4] = { 'T', 'E', 'D', 'M' };
+    constexpr uint32_t kManifestVersion = 1;
+    constexpr char const* kManifestName = ".thumper_editor_deploy";
+    constexpr char const* kStagingSuffix = ".te-deploy";
+
+    // Files handed to each pool task
+    constexpr size_t kDeployBatch = 64;
+
+    using Clock = std::chrono::steady_clock;
+
+    struct ManifestEntry {
+        // Relative to both roots
+        std::string path;
+
+        uint64_t sourceSize = 0;
+        int64_t sourceModified = 0;
+        uint64_t contentHash = 0;
+
+        // What the deployed copy looked like right after it was written
+        uint64_t size = 0;
+        int64_t modified = 0;
+    };
+
+    // Only has to tell revisions of the same file apart
+    bool hash_file(std::filesystem::path const& path, uint64_t& hash) {
+        std::ifstream file(path, std::ios::in | std::ios::binary);
+        if (!file) return false;
+
+        Checksum state(0xcbf29ce484222325ull);
+
+        // Whole words per read, only the last one can come back short
+        std::vector<char> buffer(256 * 1024);
+        while (file) {
+            file.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+            state.update(buffer.data(), static_cast<size_t>(file.gcount()));
+        }
+
+        if (file.bad()) return false;
+
+        hash = state.finish();
+        return true;
+    }
+
+#ifdef TE_LINUX
+    enum class CopyResult {
+        Done,
+        Unsupported,
+        Failed,
+    };
+
+    // Unsupported is only reported before anything was written so the next method can start over
+    CopyResult copy_range(int in, int out, uint64_t size) {
+        uint64_t copied = 0;
+        while (copied < size) {
+            ssize_t const count = ::copy_file_range(in, nullptr, out, nullptr, size - copied, 0);
+            if (count < 0) {
+                if (errno == EINTR) continue;
+                bool const unsupported = errno == EXDEV || errno == ENOSYS || errno == EINVAL || errno == EOPNOTSUPP;
+                return copied == 0 && unsupported ? CopyResult::Unsupported : CopyResult::Failed;
+            }
+            if (count == 0) break;
+            copied += static_cast<uint64_t>(count);
+        }
+        return CopyResult::Done;
+    }
+
+    CopyResult copy_sendfile(int in, int out, uint64_t size) {
+        off_t offset = 0;
+        while (static_cast<uint64_t>(offset) < size) {
+            ssize_t const count = ::sendfile(out, in, &offset, size - static_cast<uint64_t>(offset));
+            if (count < 0) {
+                if (errno == EINTR) continue;
+                bool const unsupported = errno == ENOSYS || errno == EINVAL;
+                return offset == 0 && unsupported ? CopyResult::Unsupported : CopyResult::Failed;
+            }
+            if (count == 0) break;
+        }
+        return CopyResult::Done;
+    }
+
+    CopyResult copy_buffered(int in, int out) {
+        std::vector<char> buffer(256 * 1024);
+        for (;;) {
+            ssize_t const count = ::read(in, buffer.data(), buffer.size());
+            if (count < 0) {
+                if (errno == EINTR) continue;
+                return CopyResult::Failed;
+            }
+            if (count == 0) return CopyResult::Done;
+
+            for (ssize_t written = 0; written < count;) {
+                ssize_t const result = ::write(out, buffer.data() + written, static_cast<size_t>(count - written));
+                if (result < 0) {
+                    if (errno == EINTR) continue;
+                    return CopyResult::Failed;
+                }
+                written += result;
+            }
+        }
+    }
+#endif
+
+    // copy_file_range lets the filesystem share extents or copy server side, sendfile still
+    // skips the round trip through user space, plain reads cover everything else
+    bool copy_file_contents(std::filesystem::path const& source, std::filesystem::path const& destination, std::string& error) {
+#ifdef TE_LINUX
+        int const in = ::open(source.c_str(), O_RDONLY | O_CLOEXEC);
+        if (in < 0) {
+            error = std::strerror(errno);
+            return false;
+        }
+
+        struct stat info;
+        if (::fstat(in, &info) != 0) {
+            error = std::strerror(errno);
+            ::close(in);
+            return false;
+        }
+
+        int const out = ::open(destination.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (out < 0) {
+            error = std::strerror(errno);
+            ::close(in);
+            return false;
+        }
+
+        uint64_t const size = static_cast<uint64_t>(info.st_size);
+        CopyResult result = copy_range(in, out, size);
+        if (result == CopyResult::Unsupported) result = copy_sendfile(in, out, size);
+        if (result == CopyResult::Unsupported) result = copy_buffered(in, out);
+        if (result != CopyResult::Done) error = std::strerror(errno);
+
+        ::close(out);
+        ::close(in);
+        return result == CopyResult::Done;
+#else
+        // CopyFileW underneath, which already offloads to the file system where it can
+        std::error_code ec;
+        std::filesystem::copy_file(source, destination, std::filesystem::copy_options::overwrite_existing, ec);
+        if (ec) error = ec.message();
+        return !ec;
+#endif
+    }
+
+    std::unordered_map<std::string, ManifestEntry> load_manifest(std::filesystem::path const& path) {
+        std::unordered_map<std::string, ManifestEntry> manifest;
+
+        std::ifstream file(path, std::ios::in | std::ios::binary);
+        if (!file) return manifest;
+
+        std::vector<char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        BinaryReader reader(data);
+
+        char magic[4];
+        uint32_t version, count;
+        if (!reader.read(magic) || std::memcmp(magic, kManifestMagic, sizeof(magic)) != 0) return manifest;
+        if (!reader.read(version) || version != kManifestVersion) return manifest;
+        if (!reader.read(count)) return manifest;
+
+        manifest.reserve(count);
+        for (uint32_t i = 0; i < count; ++i) {
+            ManifestEntry entry;
+            bool const ok = reader.read(entry.path) && reader.read(entry.sourceSize) && reader.read(entry.sourceModified)
+                && reader.read(entry.contentHash) && reader.read(entry.size) && reader.read(entry.modified);
+
+            if (!ok) break;
+            std::string key = entry.path;
+            manifest.emplace(std::move(key), std::move(entry));
+        }
+
+        return manifest;
+    }
+
+    bool save_manifest(std::filesystem::path const& path, std::vector<ManifestEntry> const& entries) {
+        return write_file_atomic(path, [&](std::ostream& file) {
+            file.write(kManifestMagic, sizeof(kManifestMagic));
+            write_u32(file, kManifestVersion);
+            write_u32(file, static_cast<uint32_t>(entries.size()));
+
+            for (auto const& entry : entries) {
+                write_string(file, entry.path);
+                write_u64(file, entry.sourceSize);
+                write_u64(file, static_cast<uint64_t>(entry.sourceModified));
+                write_u64(file, entry.contentHash);
+                write_u64(file, entry.size);
+                write_u64(file, static_cast<uint64_t>(entry.modified));
+            }
+
+            return true;
+        });
+    }
+}
+
+struct LevelDeployer::State {
+    struct Staged {
+        std::filesystem::path temp;
+        std::filesystem::path target;
+        ManifestEntry entry;
+        // Kept when the rename fails so the old copy is not mistaken for a stale file
+        std::optional<ManifestEntry> previous;
+    };
+
+    std::filesystem::path source;
+    std::filesystem::path destination;
+    Clock::time_point start = Clock::now();
+
+    std::atomic<bool> cancelled = false;
+    std::atomic<bool> finished = false;
+    std::atomic<size_t> total = 0;
+    std::atomic<size_t> processed = 0;
+    std::atomic<size_t> outstanding = 0;
+
+    // Read only once the listing task has handed out batches
+    std::unordered_map<std::string, ManifestEntry> manifest;
+
+    std::mutex mutex;
+    std::vector<ManifestEntry> entries;
+    std::vector<Staged> staged;
+    Report report;
+
+    void error(std::string const& path, std::string const& message) {
+        std::lock_guard lock(mutex);
+        report.errors.emplace_back(path + ": " + message);
+    }
+};
+
+LevelDeployer::LevelDeployer(ThreadPool& pool) : mPool(pool) {
+}
+
+LevelDeployer::~LevelDeployer() noexcept {
+    cancel();
+}
+
+void LevelDeployer::cancel() {
+    if (mState) mState->cancelled = true;
+}
+
+void LevelDeployer::start(std::filesystem::path source, std::filesystem::path destination) {
+    if (mState) return;
+
+    auto state = std::make_shared<State>();
+    state->source = std::move(source);
+    state->destination = std::move(destination);
+    mState = state;
+
+    // Runs on the last task to finish, nothing is renamed before every copy is staged
+    auto finish = [](std::shared_ptr<State> const& state) {
+        std::lock_guard lock(state->mutex);
+
+        if (state->cancelled.load(std::memory_order_relaxed)) {
+            std::error_code ec;
+            for (auto const& staged : state->staged)
+                std::filesystem::remove(staged.temp, ec);
+            state->report.errors.emplace_back("cancelled, nothing was changed");
+        }
+        else {
+            for (auto& staged : state->staged) {
+                std::error_code ec;
+                std::filesystem::rename(staged.temp, staged.target, ec);
+
+                if (!ec && file_stamp(staged.target, staged.entry.size, staged.entry.modified)) {
+                    ++state->report.copied;
+                    state->report.bytesCopied += staged.entry.sourceSize;
+                    state->entries.push_back(std::move(staged.entry));
+                    continue;
+                }
+
+                state->report.errors.emplace_back(staged.entry.path + ": " + (ec ? ec.message() : "could not stat after rename"));
+                std::filesystem::remove(staged.temp, ec);
+                if (staged.previous) state->entries.push_back(std::move(*staged.previous));
+            }
+
+            std::unordered_set<std::string> deployed;
+            deployed.reserve(state->entries.size());
+            for (auto const& entry : state->entries)
+                deployed.insert(entry.path);
+
+            // Only files an earlier deploy wrote are ever removed
+            for (auto const& [path, entry] : state->manifest) {
+                if (deployed.contains(path)) continue;
+
+                std::error_code ec;
+                if (std::filesystem::remove(state->destination / std::filesystem::path(std::u8string(path.begin(), path.end())), ec)) ++state->report.removed;
+            }
+
+            if (!save_manifest(state->destination / kManifestName, state->entries))
+                state->report.errors.emplace_back("could not write the deploy manifest");
+        }
+
+        state->report.files = state->total.load(std::memory_order_relaxed);
+        state->report.seconds = std::chrono::duration<double>(Clock::now() - state->start).count();
+        state->finished.store(true, std::memory_order_release);
+        wake_main_thread();
+    };
+
+    mPool.submit([state, finish, &pool = mPool]() {
+        TE_PROFILE_ZONE("Deploy List");
+
+        std::error_code ec;
+        std::filesystem::create_directories(state->destination, ec);
+        state->manifest = load_manifest(state->destination / kManifestName);
+
+        // Left behind by a deploy the process did not survive, never part of the game's files
+        std::vector<std::filesystem::path> stale;
+        for (auto it = std::filesystem::recursive_directory_iterator(state->destination, ec); !ec && it != std::filesystem::recursive_directory_iterator(); it.increment(ec)) {
+            if (it->is_regular_file(ec) && path_to_string(it->path().filename()).ends_with(kStagingSuffix)) stale.push_back(it->path());
+        }
+        for (auto const& path : stale)
+            std::filesystem::remove(path, ec);
+        ec.clear();
+
+        std::vector<std::filesystem::path> files;
+        for (auto it = std::filesystem::recursive_directory_iterator(state->source, ec); !ec && it != std::filesystem::recursive_directory_iterator(); it.increment(ec)) {
+            if (it->is_regular_file(ec) && !is_peak_cache(it->path())) files.emplace_back(it->path());
+        }
+
+        state->total = files.size();
+
+        // Held by the listing itself so batches finishing early cannot run `finish` yet
+        state->outstanding = 1;
+
+        for (size_t begin = 0; begin < files.size(); begin += kDeployBatch) {
+            size_t const end = std::min(begin + kDeployBatch, files.size());
+            std::vector<std::filesystem::path> batch(std::make_move_iterator(files.begin() + begin), std::make_move_iterator(files.begin() + end));
+
+            state->outstanding.fetch_add(1, std::memory_order_relaxed);
+            pool.submit([state, finish, batch = std::move(batch)]() {
+                TE_PROFILE_ZONE("Deploy Batch");
+
+                std::vector<ManifestEntry> entries;
+                std::vector<State::Staged> staged;
+                size_t skipped = 0;
+
+                for (auto const& file : batch) {
+                    if (state->cancelled.load(std::memory_order_relaxed)) break;
+
+                    std::filesystem::path const relative = file.lexically_relative(state->source);
+                    std::filesystem::path const target = state->destination / relative;
+
+                    ManifestEntry entry{ .path = path_to_string(relative) };
+                    state->processed.fetch_add(1, std::memory_order_relaxed);
+
+                    if (!file_stamp(file, entry.sourceSize, entry.sourceModified)) {
+                        state->error(entry.path, "could not stat");
+                        continue;
+                    }
+
+                    auto const previous = state->manifest.find(entry.path);
+                    bool const known = previous != state->manifest.end();
+
+                    // The deployed copy must still be the one we wrote, otherwise it is replaced
+                    uint64_t targetSize;
+                    int64_t targetModified;
+                    bool const intact = known && file_stamp(target, targetSize, targetModified)
+                        && targetSize == previous->second.size && targetModified == previous->second.modified;
+
+                    if (intact && previous->second.sourceSize == entry.sourceSize && previous->second.sourceModified == entry.sourceModified) {
+                        entries.push_back(previous->second);
+                        ++skipped;
+                        continue;
+                    }
+
+                    if (!hash_file(file, entry.contentHash)) {
+                        state->error(entry.path, "could not read");
+                        if (known) entries.push_back(previous->second);
+                        continue;
+                    }
+
+                    // Touched but identical, only the stamp moves on
+                    if (intact && previous->second.contentHash == entry.contentHash) {
+                        entry.size = previous->second.size;
+                        entry.modified = previous->second.modified;
+                        entries.push_back(std::move(entry));
+                        ++skipped;
+                        continue;
+                    }
+
+                    std::filesystem::path temp = target;
+                    temp += kStagingSuffix;
+
+                    std::error_code ec;
+                    std::filesystem::create_directories(target.parent_path(), ec);
+
+                    std::string error;
+                    if (!copy_file_contents(file, temp, error)) {
+                        state->error(entry.path, error);
+                        std::filesystem::remove(temp, ec);
+                        if (known) entries.push_back(previous->second);
+                        continue;
+                    }
+
+                    staged.push_back({ std::move(temp), target, std::move(entry), known ? std::optional(previous->second) : std::nullopt });
+                }
+
+                {
+                    std::lock_guard lock(state->mutex);
+                    state->entries.insert(state->entries.end(), std::make_move_iterator(entries.begin()), std::make_move_iterator(entries.end()));
+                    state->staged.insert(state->staged.end(), std::make_move_iterator(staged.begin()), std::make_move_iterator(staged.end()));
+                    state->report.skipped += skipped;
+                }
+
+                if (state->outstanding.fetch_sub(1, std::memory_order_acq_rel) == 1) finish(state);
+                else wake_main_thread();
+            });
+        }
+
+        if (state->outstanding.fetch_sub(1, std::memory_order_acq_rel) == 1) finish(state);
+    });
+}
+
+bool LevelDeployer::poll() {
+    if (!mState || !mState->finished.load(std::memory_order_acquire)) return false;
+
+    mReport = std::move(mState->report);
+    mState.reset();
+    return true;
+}
+
+bool LevelDeployer::running() const {
+    return mState != nullptr;
+}
+
+size_t LevelDeployer::processed() const {
+    return mState ? mState->processed.load(std::memory_order_relaxed) : 0;
+}
+
+size_t LevelDeployer::total() const {
+    return mState ? mState->total.load(std::memory_order_relaxed) : 0;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+// Copies every file under a source directory into a destination, normally the levels
+// into the game install. A manifest in the destination remembers the size, mtime and
+// content hash of what was deployed so unchanged files are skipped without reading them.
+// New files are copied in parallel next to their target and only renamed into place once
+// all of them are staged, so a deploy cancelled or failing while copying changes nothing.
+// The renames themselves run one file at a time, a crash among them leaves some files new
+// and some old until the next deploy. Staged copies a crash left behind are removed when
+// the next deploy starts.
+class LevelDeployer final {
+public:
+    struct Report {
+        size_t files = 0;
+        size_t copied = 0;
+        size_t skipped = 0;
+        size_t removed = 0;
+        uint64_t bytesCopied = 0;
+        double seconds = 0.0;
+        std::vector<std::string> errors;
+    };
+
+    explicit LevelDeployer(ThreadPool& pool);
+    ~LevelDeployer() noexcept;
+
+    LevelDeployer(LevelDeployer const&) = delete;
+    LevelDeployer& operator=(LevelDeployer const&) = delete;
+
+    // Ignored while a deploy is already running
+    void start(std::filesystem::path source, std::filesystem::path destination);
+
+    // Stops copying, staged copies are removed and nothing is renamed. `poll` still reports
+    // once the batches already running have stopped.
+    void cancel();
+
+    // Returns true once when a deploy finished, its report is then in `report`
+    bool poll();
+
+    bool running() const;
+    size_t processed() const;
+    size_t total() const;
+
+    inline std::optional<Report> const& report() const { return mReport; }
+private:
+    struct State;
+
+    ThreadPool& mPool;
+    std::shared_ptr<State> mState;
+    std::optional<Report> mReport;
+};
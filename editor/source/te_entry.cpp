@@ -5,9 +5,6 @@
 #include <glad/gl.h>
 #include <GLFW/glfw3.h>
 
-#include <stb_image.h>
-#include <miniaudio.h>
-
 #include <tinyfiledialogs.h>
 #include <yaml-cpp/yaml.h>
 
@@ -24,114 +21,474 @@
 #include <filesystem>
 #include <fstream>
 #include <memory>
-
-class Image final {
-public:
-    constexpr Image() = default;
-    Image(char const* aPath) {
-        mPixels = stbi_load(aPath, &mWidth, &mHeight, nullptr, 4);
+#include <optional>
+#include <unordered_set>
+#include <chrono>
+#include <cmath>
+
+#include "te_audio.hpp"
+#include "te_cli.hpp"
+#include "te_deploy.hpp"
+#include "te_frame_stats.hpp"
+#include "te_game_cache.hpp"
+#include "te_hash.hpp"
+#include "te_image.hpp"
+#include "te_level.hpp"
+#include "te_level_pack.hpp"
+#include "te_level_table.hpp"
+#include "te_profiler.hpp"
+#include "te_texture.hpp"
+#include "te_texture_cache.hpp"
+#include "te_thread_pool.hpp"
+#include "te_util.hpp"
+#include "te_watcher.hpp"
+#include "te_waveform.hpp"
+
+std::vector<std::string> split_lines(std::string const& text) {
+    std::vector<std::string> lines;
+    size_t begin = 0;
+
+    while (begin < text.size()) {
+        size_t end = text.find('\n', begin);
+        if (end == std::string::npos) end = text.size();
+
+        std::string line = text.substr(begin, end - begin);
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (!line.empty()) lines.emplace_back(std::move(line));
+
+        begin = end + 1;
     }
 
-    ~Image() noexcept {
-        stbi_image_free(mPixels);
-    }
+    return lines;
+}
+
+void hash_panel(HashDictionary& dictionary, HashSearch& search, GameCache const& gameCache, bool& open) {
+    static std::string input = "type input here";
+    static uint32_t hash = hash32(input);
+    static std::string lookup;
 
-    Image(Image const&) = delete;
-    Image& operator=(Image const&) = delete;
+    static std::string wordlistPath;
+    static std::string prefixes;
+    static std::string suffixes;
+    static std::string targets;
+    static size_t found = 0;
 
-    Image(Image&& other) noexcept { *this = std::move(other); }
-    Image& operator=(Image&& other) noexcept {
-        std::swap(mWidth, other.mWidth);
-        std::swap(mHeight, other.mHeight);
-        std::swap(mPixels, other.mPixels);
-        return *this;
-    }
+    // Collect results even while the panel is closed so long searches keep landing in the dictionary
+    for (auto& match : search.take_matches())
+        if (dictionary.add(match.hash, match.name)) ++found;
 
-    inline int width() const { return mWidth; }
-    inline int height() const { return mHeight; }
-    inline stbi_uc* pixels() const { return mPixels; }
-private:
-    int mWidth = 0, mHeight = 0;
-    stbi_uc* mPixels = nullptr;
-};
-
-struct Level {
-    std::string name;
-    std::string difficulty;
-    std::string description;
-    std::string author;
-};
-
-struct AudioEngine final {
-    void init() {
-        ma_context_init(nullptr, 0, nullptr, &mContext);
-
-        ma_device_config deviceConfig = ma_device_config_init(ma_device_type_playback);
-        deviceConfig.playback.format = ma_format_f32;
-        deviceConfig.dataCallback = [](ma_device* pDevice, void* pOutput, const void* pInput, ma_uint32 frameCount) -> void {
-            ma_engine_read_pcm_frames(reinterpret_cast<ma_engine*>(pDevice->pUserData), pOutput, frameCount, nullptr);
-        };
-        deviceConfig.pUserData = &mEngine;
+    if (!open) return;
+
+    if (ImGui::Begin("Hash Panel", &open)) {
+        if (ImGui::InputText("Input", &input)) hash = hash32(input);
+        ImGui::Text("0x%02x", hash);
+        ImGui::SameLine();
+        if (ImGui::SmallButton("Add to Dictionary")) dictionary.add(hash, input);
 
-        ma_device_init(&mContext, &deviceConfig, &mDevice);
-        ma_device_start(&mDevice);
+        if (gameCache.contains(hash)) ImGui::Text("In the game cache, %zu bytes", gameCache.find(hash).size());
+        else ImGui::TextDisabled("Not in the game cache");
 
-        ma_engine_config engineConfig = ma_engine_config_init();
-        engineConfig.pDevice = &mDevice;
+        ImGui::SeparatorText("Reverse Lookup");
+        ImGui::InputText("Hash", &lookup, ImGuiInputTextFlags_CharsHexadecimal);
 
-        ma_engine_init(&engineConfig, &mEngine);
-    }
+        if (auto lookupHash = parse_hash32(lookup)) {
+            auto names = dictionary.find(*lookupHash);
+            if (names.empty()) ImGui::TextDisabled("Unknown");
+            for (auto name : names) ImGui::TextUnformatted(name.data(), name.data() + name.size());
+        }
+
+        ImGui::TextDisabled("%zu known names", dictionary.size());
+
+        ImGui::SeparatorText("Batch");
+
+        ImGui::BeginDisabled(search.running());
+
+        if (ImGui::Button("Wordlist...")) {
+            char const* filter = "*.txt";
+            if (char* selection = tinyfd_openFileDialog("Select a Wordlist", nullptr, 1, &filter, nullptr, false))
+                wordlistPath = selection;
+        }
+        ImGui::SameLine();
+        ImGui::TextUnformatted(wordlistPath.empty() ? "No wordlist selected" : wordlistPath.c_str());
+
+        ImGui::InputTextMultiline("Prefixes", &prefixes, { 0.0f, ImGui::GetTextLineHeight() * 4.0f });
+        ImGui::InputTextMultiline("Suffixes", &suffixes, { 0.0f, ImGui::GetTextLineHeight() * 4.0f });
+        ImGui::InputTextMultiline("Targets", &targets, { 0.0f, ImGui::GetTextLineHeight() * 4.0f });
+        ImGui::SetItemTooltip("Hashes to search for, one per line.\nLeave empty to keep every candidate, up to the first %llu.", static_cast<unsigned long long>(HashSearch::kMaxMatches));
+
+        ImGui::BeginDisabled(gameCache.size() == 0);
+        if (ImGui::Button("Target Unknown Cache Files")) {
+            targets.clear();
+            for (uint32_t cached : gameCache.hashes()) {
+                if (dictionary.contains(cached)) continue;
+
+                char line[16];
+                snprintf(line, sizeof(line), "%08x\n", cached);
+                targets += line;
+            }
+        }
+        ImGui::EndDisabled();
+        ImGui::SetItemTooltip("Fill the targets with the %zu files in the game cache (%.1f MB) that have no known name.", gameCache.size(), static_cast<double>(gameCache.bytes()) / (1024.0 * 1024.0));
+
+        if (ImGui::Button("Start")) {
+            std::vector<std::string> words;
+            if (std::ifstream file(wordlistPath, std::ios::in | std::ios::binary); file) {
+                std::string line;
+                while (std::getline(file, line)) {
+                    if (!line.empty() && line.back() == '\r') line.pop_back();
+                    if (!line.empty()) words.emplace_back(std::move(line));
+                }
+            }
+
+            std::unordered_set<uint32_t> targetSet;
+            for (auto const& line : split_lines(targets))
+                if (auto target = parse_hash32(line)) targetSet.insert(*target);
+
+            found = 0;
+            search.start(split_lines(prefixes), std::move(words), split_lines(suffixes), std::move(targetSet));
+        }
+
+        ImGui::EndDisabled();
+
+        if (search.running()) {
+            ImGui::SameLine();
+            if (ImGui::Button("Cancel")) search.cancel();
+        }
+
+        if (search.total() > 0) {
+            ImGui::ProgressBar(static_cast<float>(static_cast<double>(search.processed()) / static_cast<double>(search.total())));
+            ImGui::Text("%llu / %llu candidates, %zu new names", static_cast<unsigned long long>(search.processed()), static_cast<unsigned long long>(search.total()), found);
+            ImGui::Text("%.2f Mhash/s (%s)", search.hashes_per_second() / 1e6, hash32_isa_name(hash32_detect_isa()));
 
-    void uninit() {
-        ma_engine_uninit(&mEngine);
-        ma_device_uninit(&mDevice);
-        ma_context_uninit(&mContext);
+            if (search.dropped() > 0) {
+                ImGui::TextColored({ 1.0f, 0.6f, 0.2f, 1.0f }, "Only the first %llu matches were kept, %llu more were dropped.", static_cast<unsigned long long>(HashSearch::kMaxMatches), static_cast<unsigned long long>(search.dropped()));
+                ImGui::TextDisabled("%s", "Add targets to keep only names that hit them.");
+            }
+        }
     }
+    ImGui::End();
+}
+
+void texture_cache_panel(TextureCache& cache, bool& open) {
+    if (!open) return;
 
-    ma_context mContext;
-    ma_device mDevice;
-    ma_engine mEngine;
-};
+    if (ImGui::Begin("Texture Cache", &open)) {
+        TextureCache::Stats const& stats = cache.stats();
+        uint64_t const lookups = stats.hits + stats.misses;
 
-uint32_t hash32(unsigned char const* array, unsigned int size) {
-    uint32_t h = 0x811c9dc5;
+        int budgetMb = static_cast<int>(cache.budget() / (1024 * 1024));
+        if (ImGui::SliderInt("Budget (MB)", &budgetMb, 16, 2048))
+            cache.set_budget(static_cast<size_t>(budgetMb) * 1024 * 1024);
 
-    while (size > 0) {
-        size--;
-        h = (h ^ *array) * 0x1000193;
-        array++;
+        ImGui::ProgressBar(cache.budget() > 0 ? static_cast<float>(static_cast<double>(stats.bytes) / static_cast<double>(cache.budget())) : 0.0f);
+        ImGui::Text("%zu textures, %.1f MB resident", stats.textures, static_cast<double>(stats.bytes) / (1024.0 * 1024.0));
+        ImGui::Text("%llu hits, %llu misses (%.1f%% hit rate)", static_cast<unsigned long long>(stats.hits), static_cast<unsigned long long>(stats.misses), lookups > 0 ? 100.0 * static_cast<double>(stats.hits) / static_cast<double>(lookups) : 0.0);
+        ImGui::Text("%llu evictions, %llu shared by content", static_cast<unsigned long long>(stats.evictions), static_cast<unsigned long long>(stats.shared));
     }
+    ImGui::End();
+}
+
+void audio_panel(AudioEngine const& audio, bool& open) {
+    if (!open) return;
+
+    if (ImGui::Begin("Audio", &open)) {
+        AudioEngine::Stats const stats = audio.stats();
 
-    h *= 0x2001;
-    h = (h ^ (h >> 0x7)) * 0x9;
-    h = (h ^ (h >> 0x11)) * 0x21;
+        ImGui::Text("%u Hz, %u periods of %u frames (%.1f ms)", stats.sampleRate, stats.periods, stats.periodSizeInFrames, stats.sampleRate > 0 ? 1000.0 * stats.periodSizeInFrames / stats.sampleRate : 0.0);
+        ImGui::Text("Callback %.1f us, average %.1f us, worst %.1f us", stats.lastCallbackUs, stats.averageCallbackUs, stats.maxCallbackUs);
+        ImGui::Text("%llu callbacks, %llu underruns", static_cast<unsigned long long>(stats.callbacks), static_cast<unsigned long long>(stats.underruns));
 
-    return h;
+        if (stats.bufferCapacity > 0) {
+            ImGui::ProgressBar(static_cast<float>(stats.bufferedFrames) / static_cast<float>(stats.bufferCapacity), { -1.0f, 0.0f }, "Stream buffer");
+        }
+    }
+    ImGui::End();
 }
 
-uint32_t hash32(std::string const& str) {
-    return hash32((unsigned char const*)str.data(), static_cast<unsigned int>(str.size()));
+// Peaks of the last previewed track, the wheel zooms around the cursor and dragging scrolls.
+// Every pixel reads one or two bins of the level matching the zoom, whatever the track length.
+void waveform_panel(AudioEngine const& audio, WaveformCache const& waveforms, bool& open) {
+    if (!open) return;
+
+    static double zoom = 1.0;
+    // First frame on screen
+    static double start = 0.0;
+
+    if (ImGui::Begin("Waveform", &open)) {
+        PeakPyramid const* pyramid = waveforms.pyramid();
+
+        if (waveforms.loading()) ImGui::TextDisabled("Reading peaks...");
+        else if (waveforms.track().empty()) ImGui::TextDisabled("Preview a level's audio to see its waveform");
+        else if (!pyramid || pyramid->frames() == 0) ImGui::TextDisabled("Could not decode %s", path_to_string(waveforms.track().filename()).c_str());
+
+        if (pyramid && pyramid->frames() > 0) {
+            ImGuiIO const& io = ImGui::GetIO();
+            double const frames = static_cast<double>(pyramid->frames());
+            float const width = std::max(ImGui::GetContentRegionAvail().x, 64.0f);
+
+            // Zoomed in no further than a few pixels per frame
+            double const maxZoom = std::max(1.0, frames * 4.0 / width);
+            zoom = std::clamp(zoom, 1.0, maxZoom);
+            double visible = frames / zoom;
+
+            ImGui::Text("%s, %.1f s, zoom %.0fx, level %zu", path_to_string(waveforms.track().filename()).c_str(), frames / pyramid->sample_rate(), zoom, pyramid->level_for(visible / width));
+
+            ImVec2 const origin = ImGui::GetCursorScreenPos();
+            ImVec2 const size = { width, std::max(ImGui::GetContentRegionAvail().y, 64.0f) };
+            ImGui::InvisibleButton("Peaks", size);
+
+            if (ImGui::IsItemHovered() && io.MouseWheel != 0.0f) {
+                double const cursor = (io.MousePos.x - origin.x) / width;
+                double const anchor = start + cursor * visible;
+                zoom = std::clamp(zoom * std::pow(1.25, io.MouseWheel), 1.0, maxZoom);
+                visible = frames / zoom;
+                start = anchor - cursor * visible;
+            }
+
+            if (ImGui::IsItemActive() && ImGui::IsMouseDragging(ImGuiMouseButton_Left, 0.0f)) {
+                start -= ImGui::GetMouseDragDelta(ImGuiMouseButton_Left, 0.0f).x / width * visible;
+                ImGui::ResetMouseDragDelta(ImGuiMouseButton_Left);
+            }
+
+            start = std::clamp(start, 0.0, frames - visible);
+
+            double const framesPerPixel = visible / width;
+            size_t const level = pyramid->level_for(framesPerPixel);
+            std::span<PeakBin const> const bins = pyramid->level(level);
+            double const binFrames = static_cast<double>(pyramid->bin_frames(level));
+
+            ImDrawList* drawList = ImGui::GetWindowDrawList();
+            float const middle = origin.y + size.y * 0.5f;
+            float const scale = size.y * 0.5f / 32767.0f;
+            ImU32 const peakColor = ImGui::GetColorU32(ImGuiCol_PlotLines);
+            ImU32 const rmsColor = ImGui::GetColorU32(ImGuiCol_PlotHistogram);
+
+            drawList->AddRectFilled(origin, { origin.x + size.x, origin.y + size.y }, ImGui::GetColorU32(ImGuiCol_FrameBg));
+
+            for (int x = 0; x < static_cast<int>(width); ++x) {
+                double const from = start + x * framesPerPixel;
+                size_t const first = static_cast<size_t>(from / binFrames);
+                size_t const last = std::min(std::max(first + 1, static_cast<size_t>(std::ceil((from + framesPerPixel) / binFrames))), bins.size());
+                if (first >= bins.size()) break;
+
+                int min = bins[first].min, max = bins[first].max, rms = bins[first].rms;
+                for (size_t i = first + 1; i < last; ++i) {
+                    min = std::min<int>(min, bins[i].min);
+                    max = std::max<int>(max, bins[i].max);
+                    rms = std::max<int>(rms, bins[i].rms);
+                }
+
+                float const px = origin.x + static_cast<float>(x) + 0.5f;
+                drawList->AddLine({ px, middle - max * scale }, { px, middle - min * scale + 1.0f }, peakColor);
+                drawList->AddLine({ px, middle - rms * scale }, { px, middle + rms * scale + 1.0f }, rmsColor);
+            }
+
+            // Playhead, only while this track is the one streaming
+            if (audio.streaming() && audio.stream_name() == path_to_string(waveforms.track().filename())) {
+                float const x = origin.x + static_cast<float>((audio.stream_position() * pyramid->sample_rate() - start) / framesPerPixel);
+                if (x >= origin.x && x <= origin.x + size.x) drawList->AddLine({ x, origin.y }, { x, origin.y + size.y }, IM_COL32(255, 255, 255, 200));
+            }
+        }
+    }
+    ImGui::End();
 }
 
-void hash_panel(bool& open) {
-    static std::string input = "type input here";
-    static uint32_t hash = hash32(input);
+#ifdef TE_PROFILER
+// Zones of the last moments as a flame graph, one group of lanes per thread
+void profiler_panel(bool& open) {
+    if (!open) return;
+
+    static bool paused = false;
+    static float windowMs = 100.0f;
+    static std::vector<ProfileThread> capture;
+    static int64_t captureEnd = 0;
+
+    if (ImGui::Begin("Profiler", &open)) {
+        int64_t const windowNs = static_cast<int64_t>(windowMs * 1e6f);
+        if (!paused) {
+            captureEnd = profiler_now();
+            capture = profiler_capture(captureEnd - windowNs);
+        }
+
+        ImGui::Checkbox("Paused", &paused);
+        ImGui::SameLine();
+        ImGui::SetNextItemWidth(200.0f);
+        ImGui::SliderFloat("Window (ms)", &windowMs, 5.0f, 1000.0f, "%.0f");
+        ImGui::SameLine();
+        if (ImGui::Button("Export Trace")) {
+            char const* filter = "*.json";
+            if (char const* selection = tinyfd_saveFileDialog("Export Trace", "trace.json", 1, &filter, "Chrome trace"))
+                profiler_export_chrome_trace(selection);
+        }
 
+        if (ImGui::BeginChild("Timeline")) {
+            constexpr ImU32 kColors[] = {
+                IM_COL32(86, 130, 186, 255), IM_COL32(186, 110, 86, 255), IM_COL32(96, 160, 96, 255),
+                IM_COL32(170, 140, 70, 255), IM_COL32(140, 100, 170, 255), IM_COL32(70, 150, 150, 255),
+            };
+
+            ImDrawList* drawList = ImGui::GetWindowDrawList();
+            float const laneHeight = ImGui::GetTextLineHeightWithSpacing();
+            float const width = ImGui::GetContentRegionAvail().x;
+            int64_t const windowStart = captureEnd - windowNs;
+            double const scale = static_cast<double>(width) / static_cast<double>(windowNs);
+
+            // Ends of the zones still open at each depth, events come ordered by start
+            std::vector<int64_t> ends;
+
+            for (auto const& thread : capture) {
+                ImGui::TextUnformatted(thread.name.data(), thread.name.data() + thread.name.size());
+                ImVec2 const origin = ImGui::GetCursorScreenPos();
+
+                ends.clear();
+                size_t depths = 1;
+
+                for (auto const& event : thread.events) {
+                    while (!ends.empty() && ends.back() <= event.start) ends.pop_back();
+                    size_t const depth = ends.size();
+                    ends.push_back(event.end);
+                    depths = std::max(depths, depth + 1);
+
+                    float const x0 = std::max(origin.x + static_cast<float>(static_cast<double>(event.start - windowStart) * scale), origin.x);
+                    float const x1 = std::min(origin.x + static_cast<float>(static_cast<double>(event.end - windowStart) * scale), origin.x + width);
+                    if (x1 < origin.x || x0 > origin.x + width) continue;
+
+                    ImVec2 const min = { x0, origin.y + static_cast<float>(depth) * laneHeight };
+                    ImVec2 const max = { std::max(x1, x0 + 1.0f), min.y + laneHeight - 1.0f };
+                    drawList->AddRectFilled(min, max, kColors[std::hash<std::string_view>{}(event.name) % std::size(kColors)]);
+
+                    if (max.x - min.x > 24.0f) {
+                        drawList->PushClipRect(min, max, true);
+                        drawList->AddText({ min.x + 2.0f, min.y }, IM_COL32(255, 255, 255, 255), event.name);
+                        drawList->PopClipRect();
+                    }
+
+                    if (ImGui::IsMouseHoveringRect(min, max))
+                        ImGui::SetTooltip("%s\n%.3f ms", event.name, static_cast<double>(event.end - event.start) / 1e6);
+                }
+
+                ImGui::Dummy({ width, static_cast<float>(depths) * laneHeight });
+            }
+        }
+        ImGui::EndChild();
+    }
+    ImGui::End();
+}
+#endif
+
+// Lists an opened pack from its table of contents alone, importing runs on the pool
+void level_pack_panel(LevelPack const& pack, std::filesystem::path const& path, LevelPackJob& job, bool& open) {
     if (!open) return;
 
-    if (ImGui::Begin("Hash Panel", &open)) {
-        if (ImGui::InputText("Input", &input)) hash = hash32(input);
-        ImGui::Text("0x%02x", hash);
+    if (ImGui::Begin("Level Pack", &open)) {
+        if (job.running()) {
+            ImGui::TextDisabled("Working on a level pack...");
+        }
+        else if (auto const& report = job.report()) {
+            ImGui::Text("%zu levels, %zu files, %.1f MB (%.1f MB packed) in %.0f ms", report->levels, report->files,
+                static_cast<double>(report->bytes) / (1024.0 * 1024.0), static_cast<double>(report->storedBytes) / (1024.0 * 1024.0), report->seconds * 1e3);
+
+            if (!report->errors.empty()) {
+                ImGui::SameLine();
+                ImGui::TextColored({ 1.0f, 0.4f, 0.4f, 1.0f }, "%zu failed", report->errors.size());
+                if (ImGui::BeginItemTooltip()) {
+                    for (auto const& error : report->errors)
+                        ImGui::TextUnformatted(error.c_str());
+                    ImGui::EndTooltip();
+                }
+            }
+        }
+
+        if (path.empty()) {
+            ImGui::TextDisabled("Open a pack from the Packs menu");
+        }
+        else if (!pack.is_open()) {
+            ImGui::TextDisabled("%s is not a level pack", path_to_string(path.filename()).c_str());
+        }
+        else {
+            ImGui::SeparatorText(path_to_string(path.filename()).c_str());
+
+            ImGui::BeginDisabled(job.running());
+            if (ImGui::Button("Import All")) job.import_pack(path, "levels");
+            ImGui::EndDisabled();
+            ImGui::SetItemTooltip("%s", "Unpack every level into the levels folder.\nLevels with the same folder name are replaced.");
+
+            constexpr ImGuiTableFlags kPackTableFlags = ImGuiTableFlags_BordersInner | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY | ImGuiTableFlags_Resizable;
+
+            if (ImGui::BeginTable("LevelPackTable", 5, kPackTableFlags)) {
+                ImGui::TableSetupScrollFreeze(0, 1);
+                ImGui::TableSetupColumn("Level Name");
+                ImGui::TableSetupColumn("Difficulty");
+                ImGui::TableSetupColumn("Author");
+                ImGui::TableSetupColumn("Files");
+                ImGui::TableSetupColumn("Size");
+                ImGui::TableHeadersRow();
+
+                ImGuiListClipper clipper;
+                clipper.Begin(static_cast<int>(pack.level_count()));
+                while (clipper.Step()) {
+                    for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; ++row) {
+                        LevelView const level = pack.level(static_cast<size_t>(row));
+                        auto const [first, last] = pack.level_entries(static_cast<size_t>(row));
+
+                        uint64_t bytes = 0, storedBytes = 0;
+                        for (size_t i = first; i < last; ++i) {
+                            LevelPack::Entry const entry = pack.entry(i);
+                            bytes += entry.size;
+                            storedBytes += entry.storedSize;
+                        }
+
+                        ImGui::TableNextRow();
+
+                        ImGui::TableNextColumn();
+                        ImGui::TextUnformatted(level.name.data(), level.name.data() + level.name.size());
+                        ImGui::SetItemTooltip("%s", level.path.data());
+
+                        ImGui::TableNextColumn();
+                        ImGui::TextUnformatted(level.difficulty.data(), level.difficulty.data() + level.difficulty.size());
+
+                        ImGui::TableNextColumn();
+                        ImGui::TextUnformatted(level.author.data(), level.author.data() + level.author.size());
+
+                        ImGui::TableNextColumn();
+                        ImGui::Text("%zu", last - first);
+
+                        ImGui::TableNextColumn();
+                        ImGui::Text("%.1f MB", static_cast<double>(bytes) / (1024.0 * 1024.0));
+                        ImGui::SetItemTooltip("%.1f MB in the pack", static_cast<double>(storedBytes) / (1024.0 * 1024.0));
+                    }
+                }
+
+                ImGui::EndTable();
+            }
+        }
     }
     ImGui::End();
 }
 
-void about_panel(GLuint icon, bool& open) {
+// Lists the audio files inside a level directory, picking one streams it
+void level_preview_menu(AudioEngine& audio, WaveformCache& waveforms, LevelView const& level) {
+    bool empty = true;
+
+    std::error_code ec;
+    for (auto it = std::filesystem::directory_iterator(std::filesystem::path(std::u8string(level.path.begin(), level.path.end())), ec); !ec && it != std::filesystem::directory_iterator(); it.increment(ec)) {
+        if (it->path().extension() != ".ogg" || !it->is_regular_file(ec)) continue;
+
+        empty = false;
+        std::string const name = path_to_string(it->path().filename());
+        if (ImGui::MenuItem(name.c_str(), nullptr, audio.streaming() && audio.stream_name() == name) && audio.play_stream(it->path())) waveforms.open(it->path());
+    }
+
+    if (empty) ImGui::TextDisabled("No audio in this level");
+}
+
+void about_panel(TextureCache& textures, bool& open) {
     if (!open) return;
 
     if (open) {
         if (ImGui::Begin("About Thumper Mod Loader v2.0.0.0", &open)) {
-            ImGui::Image((ImTextureID)(uintptr_t)icon, { 128.0f, 128.0f });
+            // Larger icon than the window one
+            ImGui::Image((ImTextureID)(uintptr_t)textures.get("thumper_modding_tool.png"), { 128.0f, 128.0f });
             ImGui::TextUnformatted("Thumper Mod Loader");
             ImGui::TextUnformatted("Version 2.0.0.0");
             ImGui::TextUnformatted("Copyright (c) 2081");
@@ -142,11 +499,6 @@ void about_panel(GLuint icon, bool& open) {
     }
 }
 
-std::string path_to_string(std::filesystem::path const& path) {
-    auto const u8string = path.generic_u8string();
-    return std::string(reinterpret_cast<char const*>(u8string.data()), u8string.cend() - u8string.cbegin());
-}
-
 std::optional<std::filesystem::path> select_directory_from_file() {
     char const* filter = "THUMPER_*.exe";
     char* selection = tinyfd_openFileDialog("Select your Thumper Installation Directory", nullptr, 1, &filter, nullptr, false);
@@ -158,7 +510,16 @@ std::optional<std::filesystem::path> select_directory_save() {
     auto path = select_directory_from_file();
 
     if (path) {
-        YAML::Node rootNode = YAML::Node();
+        // Only the path changes, every other setting in the file is kept
+        YAML::Node rootNode;
+        try {
+            rootNode = YAML::LoadFile("config.yaml");
+        }
+        catch (YAML::Exception const&) {
+            // Missing or unreadable, start a new one
+        }
+
+        if (!rootNode.IsMap()) rootNode = YAML::Node(YAML::NodeType::Map);
         rootNode["path"] = path_to_string(path.value());
 
         std::ofstream file("config.yaml", std::ios::out | std::ios::binary);
@@ -198,12 +559,22 @@ void imgui_uninit() {
 }
 
 int main(int argc, char** argv) {
+    if (auto result = run_cli(argc, argv)) return *result;
+
+    TE_PROFILE_THREAD("Main");
+
     // Read configs
     std::optional<std::filesystem::path> thumperPath = std::nullopt;
+    size_t textureBudgetMb = 256;
+    AudioConfig audioConfig;
 
     try {
         YAML::Node rootNode = YAML::LoadFile("config.yaml");
         std::string str = rootNode["path"].as<std::string>("");
+        textureBudgetMb = rootNode["texture_budget_mb"].as<size_t>(textureBudgetMb);
+        audioConfig.periodSizeInFrames = rootNode["audio_period_frames"].as<uint32_t>(audioConfig.periodSizeInFrames);
+        audioConfig.periods = rootNode["audio_periods"].as<uint32_t>(audioConfig.periods);
+        audioConfig.streamBufferMs = rootNode["audio_stream_buffer_ms"].as<uint32_t>(audioConfig.streamBufferMs);
 
         if (!str.empty()) {
             thumperPath = std::filesystem::path(str);
@@ -247,56 +618,101 @@ int main(int argc, char** argv) {
 
 	gladLoadGL(&glfwGetProcAddress);
 
+    glfwSwapInterval(1);
+    set_wake_handler(&glfwPostEmptyEvent);
+
     AudioEngine audioEngine;
-    audioEngine.init();
-    ma_engine_play_sound(&audioEngine.mEngine, "UIBoot.ogg", nullptr);
+    audioEngine.init(audioConfig);
+    audioEngine.play_sound("UIBoot.ogg");
 
-    // Load larger icon, seen in the about panel
-    GLuint iconTexture;
-    {
-        Image image("thumper_modding_tool.png");
-        glCreateTextures(GL_TEXTURE_2D, 1, &iconTexture);
-        glTextureStorage2D(iconTexture, 1, GL_RGBA8, image.width(), image.height());
-        glTextureSubImage2D(iconTexture, 0, 0, 0, image.width(), image.height(), GL_RGBA, GL_UNSIGNED_BYTE, image.pixels());
-        glTextureParameteri(iconTexture, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    }
+    ThreadPool threadPool;
 
-    // Difficulty ranking texture, Should be converted to an imgui table
-    GLuint diffTexture;
-    {
-        Image image("diff.png");
-        glCreateTextures(GL_TEXTURE_2D, 1, &diffTexture);
-        glTextureStorage2D(diffTexture, 1, GL_RGBA8, image.width(), image.height());
-        glTextureSubImage2D(diffTexture, 0, 0, 0, image.width(), image.height(), GL_RGBA, GL_UNSIGNED_BYTE, image.pixels());
-        glTextureParameteri(diffTexture, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    }
+    // Decoded on the pool and streamed in over the following frames
+    TextureStreamer textureStreamer(threadPool);
+    textureStreamer.init();
+    TextureCache textures(textureStreamer, textureBudgetMb * 1024 * 1024);
 
     imgui_init(window);
 
     bool showHashPanel = false;
+#ifdef TE_PROFILER
+    bool showProfiler = false;
+#endif
+    bool showLevelPack = false;
     bool showAboutPanel = false;
     bool showDifficultyExplanation = false;
     bool modMode = false;
+    bool showFrameStats = false;
+    bool showTextureCache = false;
+    bool showAudio = false;
+    bool showWaveform = false;
+    bool showDemoWindow = false;
+    bool powerSaving = true;
 
-    std::vector<Level> levels;
-
-    for (auto& entry : std::filesystem::directory_iterator("levels")) {
-        if (!entry.is_directory()) continue;
-        std::filesystem::path path = entry.path() / "LEVEL DETAILS.txt";
-        if (!std::filesystem::exists(path)) continue;
-    
-        YAML::Node node = YAML::LoadFile(path_to_string(path));
-
-        levels.emplace_back(
-            node["level_name"].as<std::string>(""),
-            node["difficulty"].as<std::string>(""),
-            node["description"].as<std::string>(""),
-            node["author"].as<std::string>("")
-        );
-    }
+    FrameStats frameStats;
+    frameStats.init();
+
+    // Frames still drawn after the last event so hover and fade transitions can finish
+    constexpr int kSettleFrames = 3;
+    int settleFrames = kSettleFrames;
+
+    HashDictionary hashDictionary;
+    hashDictionary.load("hash_dictionary.txt");
+    HashSearch hashSearch;
+
+    LevelLibrary levelLibrary(threadPool, "levels", "level_index.bin");
+    levelLibrary.scan();
+
+    LevelTableModel levelTable;
+    std::string levelSearch;
+
+    LevelDeployer levelDeployer(threadPool);
+
+    LevelPack levelPack;
+    std::filesystem::path levelPackPath;
+    LevelPackJob levelPackJob(threadPool);
+
+    WaveformCache waveforms(threadPool);
+
+    GameCache gameCache(threadPool);
+    gameCache.open(*thumperPath / "cache", "game_cache_index.bin");
+
+    DirectoryWatcher levelWatcher("levels");
+    DirectoryWatcher::Changes levelChanges;
 
 	while (!glfwWindowShouldClose(window)) {
-		glfwPollEvents();
+        // Block while nothing is animating or loading, background work wakes the loop through `wake_main_thread`
+        bool const busy = levelLibrary.scanning() || hashSearch.running() || textureStreamer.busy() || levelDeployer.running() || levelPackJob.running() || waveforms.loading() || gameCache.loading() || audioEngine.streaming();
+        if (powerSaving && !busy && settleFrames == 0) {
+            // A focused text field still needs its cursor to blink
+            double const timeout = ImGui::GetIO().WantTextInput ? 0.5 : 2.0;
+
+            TE_PROFILE_ZONE("Wait Events");
+            auto const waitStart = std::chrono::steady_clock::now();
+            glfwWaitEventsTimeout(timeout);
+            frameStats.add_idle(std::chrono::duration<double>(std::chrono::steady_clock::now() - waitStart).count());
+
+            settleFrames = kSettleFrames;
+        }
+        else {
+            glfwPollEvents();
+            if (settleFrames > 0) --settleFrames;
+        }
+
+        TE_PROFILE_ZONE("Frame");
+        frameStats.begin_frame();
+
+        if (levelWatcher.take(levelChanges)) {
+            if (levelChanges.rescan) levelLibrary.scan();
+            else levelLibrary.refresh(levelChanges.directories);
+        }
+
+        levelLibrary.poll();
+        levelDeployer.poll();
+        levelPackJob.poll();
+        waveforms.poll();
+        gameCache.poll();
+        textureStreamer.update();
 
 #ifdef TE_WINDOWS
         ImGui::GetIO().ConfigDebugIsDebuggerPresent = ::IsDebuggerPresent();
@@ -306,12 +722,20 @@ int main(int argc, char** argv) {
         ImGui_ImplGlfw_NewFrame();
         ImGui::NewFrame();
 
-        hash_panel(showHashPanel);
-        about_panel(iconTexture, showAboutPanel);
+        hash_panel(hashDictionary, hashSearch, gameCache, showHashPanel);
+#ifdef TE_PROFILER
+        profiler_panel(showProfiler);
+#endif
+        level_pack_panel(levelPack, levelPackPath, levelPackJob, showLevelPack);
+        about_panel(textures, showAboutPanel);
+        texture_cache_panel(textures, showTextureCache);
+        audio_panel(audioEngine, showAudio);
+        waveform_panel(audioEngine, waveforms, showWaveform);
 
         if (showDifficultyExplanation) {
             if (ImGui::Begin("Difficulty Explanation", &showDifficultyExplanation)) {
-                ImGui::Image((ImTextureID)(uintptr_t)diffTexture, ImGui::GetContentRegionAvail());
+                // Difficulty ranking texture, Should be converted to an imgui table
+                ImGui::Image((ImTextureID)(uintptr_t)textures.get("diff.png"), ImGui::GetContentRegionAvail());
             }
             ImGui::End();
         }
@@ -322,15 +746,66 @@ int main(int argc, char** argv) {
 
                 if (ImGui::BeginMenu("Options")) {
                     if (ImGui::MenuItem("Change Game Dir")) {
-                        if (auto path = select_directory_save()) thumperPath = path;
+                        if (auto path = select_directory_save(); path && path != thumperPath) {
+                            thumperPath = path;
+                            // The cached files come from the game, so they follow it to the new directory
+                            gameCache.open(*thumperPath / "cache", "game_cache_index.bin");
+                        }
                     }
 
                     ImGui::MenuItem("Hash Panel", nullptr, &showHashPanel);
+                    ImGui::Separator();
+                    ImGui::MenuItem("Power Saving", nullptr, &powerSaving);
+                    ImGui::MenuItem("Frame Stats", nullptr, &showFrameStats);
+                    ImGui::MenuItem("Texture Cache", nullptr, &showTextureCache);
+                    ImGui::MenuItem("Audio", nullptr, &showAudio);
+                    ImGui::MenuItem("Waveform", nullptr, &showWaveform);
+#ifdef TE_PROFILER
+                    ImGui::MenuItem("Profiler", nullptr, &showProfiler);
+#endif
+                    ImGui::MenuItem("ImGui Demo", nullptr, &showDemoWindow);
+                    ImGui::Separator();
                     ImGui::MenuItem("[!!!] Reset Settings [!!!]", nullptr, nullptr, false);
 
                     ImGui::EndMenu();
                 }
 
+                if (ImGui::BeginMenu("Packs")) {
+                    char const* filter = "*.tepack";
+
+                    if (ImGui::MenuItem("Open Pack...")) {
+                        if (char* selection = tinyfd_openFileDialog("Open a Level Pack", nullptr, 1, &filter, "Level packs", false)) {
+                            levelPackPath = selection;
+                            levelPack.open(levelPackPath);
+                            showLevelPack = true;
+                        }
+                    }
+
+                    if (ImGui::MenuItem("Export Levels...", nullptr, nullptr, !levelPackJob.running())) {
+                        if (char* selection = tinyfd_saveFileDialog("Export Levels", "levels.tepack", 1, &filter, "Level packs")) {
+                            auto const& levels = levelLibrary.levels();
+                            std::vector<std::filesystem::path> directories;
+                            directories.reserve(levels.size());
+                            for (size_t i = 0; i < levels.size(); ++i)
+                                directories.emplace_back(std::u8string(reinterpret_cast<char8_t const*>(levels[i].path.data()), levels[i].path.size()));
+
+                            levelPackJob.export_pack(std::move(directories), selection, true);
+                            showLevelPack = true;
+                        }
+                    }
+
+                    if (ImGui::MenuItem("Import Pack...", nullptr, nullptr, !levelPackJob.running())) {
+                        if (char* selection = tinyfd_openFileDialog("Import a Level Pack", nullptr, 1, &filter, "Level packs", false)) {
+                            levelPackJob.import_pack(selection, "levels");
+                            showLevelPack = true;
+                        }
+                    }
+
+                    ImGui::Separator();
+                    ImGui::MenuItem("Level Pack", nullptr, &showLevelPack);
+                    ImGui::EndMenu();
+                }
+
                 if (ImGui::BeginMenu("Help")) {
                     ImGui::MenuItem("About...", nullptr, &showAboutPanel);
                     if (ImGui::MenuItem("Discord Server", nullptr, nullptr, ImGui::GetCurrentContext()->PlatformIO.Platform_OpenInShellFn)) {
@@ -366,45 +841,121 @@ int main(int argc, char** argv) {
             ImGui::PopStyleColor();
 
             
-            ImGui::BeginDisabled(!modMode);
-            ImGui::Button("Update Levels");
+            ImGui::BeginDisabled(!modMode || levelDeployer.running());
+            if (ImGui::Button("Update Levels")) levelDeployer.start("levels", *thumperPath / "levels");
             ImGui::EndDisabled();
             ImGui::SetItemTooltip("%s", "Update Thumper with these levels and splash screen.\nAdding or removing levels requires a re-launch of the game.");
+
+            if (levelDeployer.running()) {
+                size_t const total = levelDeployer.total();
+                ImGui::SameLine();
+                ImGui::ProgressBar(total > 0 ? static_cast<float>(levelDeployer.processed()) / static_cast<float>(total) : 0.0f, { -1.0f, 0.0f });
+            }
+            else if (auto const& report = levelDeployer.report()) {
+                ImGui::SameLine();
+                ImGui::Text("%zu copied, %zu unchanged, %zu removed in %.0f ms", report->copied, report->skipped, report->removed, report->seconds * 1e3);
+
+                if (!report->errors.empty()) {
+                    ImGui::SameLine();
+                    ImGui::TextColored({ 1.0f, 0.4f, 0.4f, 1.0f }, "%zu failed", report->errors.size());
+                    if (ImGui::BeginItemTooltip()) {
+                        for (auto const& error : report->errors)
+                            ImGui::TextUnformatted(error.c_str());
+                        ImGui::EndTooltip();
+                    }
+                }
+            }
         
             ImGui::SeparatorText("Levels");
+
+            if (audioEngine.streaming()) {
+                double const length = audioEngine.stream_length();
+                if (ImGui::SmallButton("Stop")) audioEngine.stop_stream();
+                ImGui::SameLine();
+
+                char overlay[64];
+                snprintf(overlay, sizeof(overlay), "%.0f / %.0f s", audioEngine.stream_position(), length);
+                ImGui::ProgressBar(length > 0.0 ? static_cast<float>(audioEngine.stream_position() / length) : 0.0f, { -1.0f, 0.0f }, overlay);
+                ImGui::SetItemTooltip("Previewing %s", audioEngine.stream_name().c_str());
+            }
+
+            if (levelLibrary.scanning()) {
+                size_t const total = levelLibrary.total();
+                float const fraction = total > 0 ? static_cast<float>(levelLibrary.scanned()) / static_cast<float>(total) : 0.0f;
+                char overlay[64];
+                snprintf(overlay, sizeof(overlay), "Scanning levels %zu/%zu", levelLibrary.scanned(), total);
+                ImGui::ProgressBar(fraction, { -1.0f, 0.0f }, overlay);
+            }
             
-            if (ImGui::BeginTable("ModeLoaderLevlTable", 4, ImGuiTableFlags_BordersInner)) {
+            if (ImGui::InputTextWithHint("##LevelSearch", "Search levels", &levelSearch))
+                levelTable.set_filter(levelSearch);
 
-                ImGui::TableNextRow();
-                ImGui::TableNextColumn();
-                ImGui::TextUnformatted("Level Name");
+            ImGui::SameLine();
+            ImGui::TextDisabled("%zu / %zu", levelTable.rows().size(), levelLibrary.levels().size());
 
-                ImGui::TableNextColumn();
-                ImGui::TextUnformatted("Difficulty");
-                ImGui::SameLine();
-                if (ImGui::SmallButton("?"))
-                    showDifficultyExplanation = true;
+            constexpr ImGuiTableFlags kLevelTableFlags = ImGuiTableFlags_BordersInner | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY | ImGuiTableFlags_Resizable | ImGuiTableFlags_Sortable;
+
+            if (ImGui::BeginTable("ModeLoaderLevlTable", 4, kLevelTableFlags)) {
+                ImGui::TableSetupScrollFreeze(0, 1);
+                char const* const columnNames[] = { "Level Name", "Difficulty", "Description", "Author" };
+                for (int column = 0; column < 4; ++column)
+                    ImGui::TableSetupColumn(columnNames[column], column == 0 ? ImGuiTableColumnFlags_DefaultSort : ImGuiTableColumnFlags_None, 0.0f, static_cast<ImGuiID>(column));
 
-                ImGui::TableNextColumn();
-                ImGui::TextUnformatted("Description");
+                // Headers are submitted by hand to fit the difficulty explanation button
+                ImGui::TableNextRow(ImGuiTableRowFlags_Headers);
+                for (int column = 0; column < 4; ++column) {
+                    ImGui::TableSetColumnIndex(column);
 
-                ImGui::TableNextColumn();
-                ImGui::TextUnformatted("Author");
+                    if (column == static_cast<int>(LevelColumn::Difficulty)) {
+                        if (ImGui::SmallButton("?"))
+                            showDifficultyExplanation = true;
+                        ImGui::SameLine();
+                    }
 
-                for (auto const& level : levels) {
-                    ImGui::TableNextRow();
+                    ImGui::TableHeader(columnNames[column]);
+                }
 
-                    ImGui::TableNextColumn();
-                    ImGui::TextUnformatted(level.name.c_str());
+                if (ImGuiTableSortSpecs* sortSpecs = ImGui::TableGetSortSpecs(); sortSpecs && sortSpecs->SpecsCount > 0) {
+                    levelTable.set_sort(static_cast<LevelColumn>(sortSpecs->Specs[0].ColumnUserID), sortSpecs->Specs[0].SortDirection == ImGuiSortDirection_Descending);
+                    sortSpecs->SpecsDirty = false;
+                }
 
-                    ImGui::TableNextColumn();
-                    ImGui::TextUnformatted(level.difficulty.c_str());
+                levelTable.update(levelLibrary.levels(), levelLibrary.generation(), !levelLibrary.scanning());
 
-                    ImGui::TableNextColumn();
-                    ImGui::TextUnformatted(level.description.c_str());
+                auto const& levels = levelLibrary.levels();
+                auto const rows = levelTable.rows();
 
-                    ImGui::TableNextColumn();
-                    ImGui::TextUnformatted(level.author.c_str());
+                // Rows are a single line tall so only the visible slice is submitted
+                ImGuiListClipper clipper;
+                clipper.Begin(static_cast<int>(rows.size()));
+                while (clipper.Step()) {
+                    for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; ++row) {
+                        LevelView const level = levels[rows[row]];
+
+                        ImGui::TableNextRow();
+
+                        ImGui::TableNextColumn();
+                        ImGui::TextUnformatted(level.name.data(), level.name.data() + level.name.size());
+
+                        ImGui::PushID(level.path.data(), level.path.data() + level.path.size());
+                        if (ImGui::BeginPopupContextItem("Preview")) {
+                            level_preview_menu(audioEngine, waveforms, level);
+                            ImGui::EndPopup();
+                        }
+                        ImGui::PopID();
+
+                        ImGui::TableNextColumn();
+                        ImGui::TextUnformatted(level.difficulty.data(), level.difficulty.data() + level.difficulty.size());
+
+                        ImGui::TableNextColumn();
+                        size_t const lineEnd = level.description.find_first_of("\r\n");
+                        ImGui::TextUnformatted(level.description.data(), level.description.data() + std::min(lineEnd, level.description.size()));
+                        // Views into the level list are nul terminated
+                        if (lineEnd != std::string_view::npos) ImGui::SetItemTooltip("%s", level.description.data());
+
+                        ImGui::TableNextColumn();
+                        ImGui::TextUnformatted(level.author.data(), level.author.data() + level.author.size());
+                    }
                 }
 
                 ImGui::EndTable();
@@ -412,7 +963,8 @@ int main(int argc, char** argv) {
         }
         ImGui::End();
 
-        ImGui::ShowDemoWindow();
+        if (showDemoWindow) ImGui::ShowDemoWindow(&showDemoWindow);
+        frameStats.draw_overlay(showFrameStats);
 
         ImGui::Render();
         int display_w, display_h;
@@ -420,20 +972,40 @@ int main(int argc, char** argv) {
         glViewport(0, 0, display_w, display_h);
         glClearColor(0.3f, 0.0f, 0.0f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT);
+        frameStats.begin_gpu();
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        frameStats.end_gpu();
 
         if (ImGui::GetIO().ConfigFlags & ImGuiConfigFlags_ViewportsEnable) {
+            TE_PROFILE_ZONE("Platform Windows");
             GLFWwindow* backup_current_context = glfwGetCurrentContext();
             ImGui::UpdatePlatformWindows();
             ImGui::RenderPlatformWindowsDefault();
             glfwMakeContextCurrent(backup_current_context);
         }
 
+        frameStats.end_frame(ImGui::GetDrawData());
+        textures.end_frame();
+
+        TE_PROFILE_ZONE("Swap Buffers");
 		glfwSwapBuffers(window);
 	}
 
-    glDeleteTextures(1, &diffTexture);
-    glDeleteTextures(1, &iconTexture);
+    textureStreamer.uninit();
+
+    // Nothing may post to glfw once it terminates, background work is stopped and drained first
+    hashSearch.cancel();
+    levelLibrary.cancel();
+    levelDeployer.cancel();
+    waveforms.cancel();
+    levelPackJob.cancel();
+    gameCache.cancel();
+    threadPool.wait_idle();
+    set_wake_handler(nullptr);
+
+    if (hashDictionary.dirty()) hashDictionary.save("hash_dictionary.txt");
+
+    frameStats.uninit();
 
     imgui_uninit();
 
@@ -0,0 +1,102 @@
+#include "te_frame_stats.hpp"
+
+#include <imgui.h>
+
+void FrameStats::init() {
+    glCreateQueries(GL_TIME_ELAPSED, static_cast<GLsizei>(mQueries.size()), mQueries.data());
+}
+
+void FrameStats::uninit() {
+    glDeleteQueries(static_cast<GLsizei>(mQueries.size()), mQueries.data());
+}
+
+void FrameStats::add_idle(double seconds) {
+    mWindowIdle += seconds;
+}
+
+void FrameStats::begin_frame() {
+    mFrameStart = Clock::now();
+}
+
+void FrameStats::begin_gpu() {
+    size_t const slot = mQueryIndex;
+
+    // Results are read a few frames late so the cpu never waits on the gpu
+    if (mQueryPending[slot]) {
+        GLuint available = GL_FALSE;
+        glGetQueryObjectuiv(mQueries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+
+        if (!available) {
+            mQueryActive = false;
+            return;
+        }
+
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(mQueries[slot], GL_QUERY_RESULT, &elapsed);
+        mGpuMs = static_cast<float>(static_cast<double>(elapsed) / 1e6);
+        mQueryPending[slot] = false;
+    }
+
+    glBeginQuery(GL_TIME_ELAPSED, mQueries[slot]);
+    mQueryActive = true;
+}
+
+void FrameStats::end_gpu() {
+    if (!mQueryActive) return;
+
+    glEndQuery(GL_TIME_ELAPSED);
+    mQueryPending[mQueryIndex] = true;
+    mQueryIndex = (mQueryIndex + 1) % kQueryCount;
+    mQueryActive = false;
+}
+
+void FrameStats::end_frame(ImDrawData const* drawData) {
+    auto const now = Clock::now();
+    mCpuMs = std::chrono::duration<float, std::milli>(now - mFrameStart).count();
+
+    mDrawCalls = 0;
+    mVertices = 0;
+    if (drawData) {
+        for (ImDrawList const* list : drawData->CmdLists)
+            mDrawCalls += list->CmdBuffer.Size;
+        mVertices = drawData->TotalVtxCount;
+    }
+
+    mCpuHistory[mHistoryIndex] = mCpuMs;
+    mGpuHistory[mHistoryIndex] = mGpuMs;
+    mHistoryIndex = (mHistoryIndex + 1) % kHistory;
+
+    ++mWindowFrames;
+    double const window = std::chrono::duration<double>(now - mWindowStart).count();
+    if (window >= 1.0) {
+        mIdleRatio = static_cast<float>(mWindowIdle / window);
+        mFramesPerSecond = static_cast<float>(mWindowFrames / window);
+        mWindowStart = now;
+        mWindowIdle = 0.0;
+        mWindowFrames = 0;
+    }
+}
+
+void FrameStats::draw_overlay(bool& open) {
+    if (!open) return;
+
+    constexpr float kPadding = 10.0f;
+    ImGuiViewport const* viewport = ImGui::GetMainViewport();
+    ImGui::SetNextWindowPos({ viewport->WorkPos.x + viewport->WorkSize.x - kPadding, viewport->WorkPos.y + kPadding }, ImGuiCond_Always, { 1.0f, 0.0f });
+    ImGui::SetNextWindowViewport(viewport->ID);
+    ImGui::SetNextWindowBgAlpha(0.35f);
+
+    constexpr ImGuiWindowFlags kFlags = ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoSavedSettings
+        | ImGuiWindowFlags_NoFocusOnAppearing | ImGuiWindowFlags_NoNav | ImGuiWindowFlags_NoDocking | ImGuiWindowFlags_NoMove;
+
+    if (ImGui::Begin("Frame Stats", &open, kFlags)) {
+        ImGui::Text("CPU %.2f ms", mCpuMs);
+        ImGui::Text("GPU %.2f ms", mGpuMs);
+        ImGui::Text("%d draw calls, %d vertices", mDrawCalls, mVertices);
+        ImGui::Text("%.1f fps, %.0f%% idle", mFramesPerSecond, mIdleRatio * 100.0f);
+
+        ImGui::PlotLines("##Cpu", mCpuHistory.data(), static_cast<int>(kHistory), static_cast<int>(mHistoryIndex), "CPU", 0.0f, 33.3f, { 200.0f, 40.0f });
+        ImGui::PlotLines("##Gpu", mGpuHistory.data(), static_cast<int>(kHistory), static_cast<int>(mHistoryIndex), "GPU", 0.0f, 33.3f, { 200.0f, 40.0f });
+    }
+    ImGui::End();
+}
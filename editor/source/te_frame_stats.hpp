@@ -0,0 +1,55 @@
+#pragma once
+
+#include <glad/gl.h>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+struct ImDrawData;
+
+// Per frame cpu time, gpu time from timer queries, draw calls and how much of the
+// wall clock the event loop spent blocked waiting for input
+class FrameStats final {
+public:
+    void init();
+    void uninit();
+
+    // Seconds the loop spent blocked before this frame
+    void add_idle(double seconds);
+
+    void begin_frame();
+    void begin_gpu();
+    void end_gpu();
+    void end_frame(ImDrawData const* drawData);
+
+    void draw_overlay(bool& open);
+private:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr size_t kQueryCount = 4;
+    static constexpr size_t kHistory = 120;
+
+    std::array<GLuint, kQueryCount> mQueries{};
+    std::array<bool, kQueryCount> mQueryPending{};
+    size_t mQueryIndex = 0;
+    bool mQueryActive = false;
+
+    Clock::time_point mFrameStart;
+
+    std::array<float, kHistory> mCpuHistory{};
+    std::array<float, kHistory> mGpuHistory{};
+    size_t mHistoryIndex = 0;
+
+    float mCpuMs = 0.0f;
+    float mGpuMs = 0.0f;
+    int mDrawCalls = 0;
+    int mVertices = 0;
+
+    // Idle ratio is accumulated over a one second window
+    Clock::time_point mWindowStart = Clock::now();
+    double mWindowIdle = 0.0;
+    int mWindowFrames = 0;
+    float mIdleRatio = 0.0f;
+    float mFramesPerSecond = 0.0f;
+};
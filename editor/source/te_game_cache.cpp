@@ -0,0 +1,219 @@
+#include "te_game_cache.hpp"
+#include "te_hash.hpp"
+#include "te_profiler.hpp"
+#include "te_thread_pool.hpp"
+#include "te_util.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <optional>
+#include <string>
+
+namespace {
+    constexpr char kIndexMagic[4] = { 'T', 'E', 'C', 'I' };
+    constexpr uint32_t kIndexVersion = 1;
+
+    struct FileList {
+        std::string directory;
+        int64_t modified = 0;
+
+        struct File {
+            uint32_t hash;
+            std::string name;
+            uint64_t size;
+        };
+
+        std::vector<File> files;
+    };
+
+    std::optional<FileList> load_file_list(std::filesystem::path const& path) {
+        std::ifstream file(path, std::ios::in | std::ios::binary);
+        if (!file) return std::nullopt;
+
+        std::vector<char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        BinaryReader reader(data);
+
+        FileList list;
+        char magic[4];
+        uint32_t version, count;
+        if (!reader.read(magic) || std::memcmp(magic, kIndexMagic, sizeof(magic)) != 0) return std::nullopt;
+        if (!reader.read(version) || version != kIndexVersion) return std::nullopt;
+        if (!reader.read(list.directory) || !reader.read(list.modified) || !reader.read(count)) return std::nullopt;
+
+        list.files.resize(count);
+        for (auto& entry : list.files) {
+            // Unlike the level index a partial list is useless, the directory has to be listed again
+            if (!reader.read(entry.hash) || !reader.read(entry.name) || !reader.read(entry.size)) return std::nullopt;
+        }
+
+        return list;
+    }
+
+    void save_file_list(std::filesystem::path const& path, FileList const& list) {
+        write_file_atomic(path, [&](std::ostream& file) {
+            file.write(kIndexMagic, sizeof(kIndexMagic));
+            write_u32(file, kIndexVersion);
+            write_string(file, list.directory);
+            write_u64(file, static_cast<uint64_t>(list.modified));
+            write_u32(file, static_cast<uint32_t>(list.files.size()));
+
+            for (auto const& entry : list.files) {
+                write_u32(file, entry.hash);
+                write_string(file, entry.name);
+                write_u64(file, entry.size);
+            }
+
+            return true;
+        });
+    }
+}
+
+GameCache::Table::Slot const* GameCache::Table::find(uint32_t hash) const {
+    if (slots.empty()) return nullptr;
+
+    // hash32 output is already well mixed, its low bits pick the slot directly
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        Slot const& slot = slots[i];
+        if (slot.file == 0) return nullptr;
+        if (slot.hash == hash) return &slot;
+    }
+}
+
+GameCache::GameCache(ThreadPool& pool) : mPool(pool) {
+}
+
+void GameCache::open(std::filesystem::path directory, std::filesystem::path indexPath) {
+    // Two opens finishing would both save the file list, only the last one counts
+    cancel();
+
+    auto pending = std::make_shared<Pending>();
+    mPending = pending;
+
+    mPool.submit([pending, directory = std::move(directory), indexPath = std::move(indexPath)]() {
+        TE_PROFILE_ZONE("Game Cache Open");
+
+        auto table = std::make_unique<Table>();
+
+        std::error_code ec;
+        int64_t const modified = std::filesystem::last_write_time(directory, ec).time_since_epoch().count();
+
+        FileList list;
+        list.directory = path_to_string(directory);
+        list.modified = modified;
+
+        // Adding, removing or renaming a file bumps the directory mtime. Nothing is opened here,
+        // a file rewritten in place is simply mapped as it is once asked for.
+        if (auto saved = load_file_list(indexPath); !ec && saved && saved->directory == list.directory && saved->modified == modified) {
+            table->reused = true;
+            list = std::move(*saved);
+        }
+        else {
+            for (auto it = std::filesystem::directory_iterator(directory, ec); !ec && it != std::filesystem::directory_iterator(); it.increment(ec)) {
+                if (pending->cancelled.load(std::memory_order_relaxed)) return;
+                if (!it->is_regular_file(ec)) continue;
+
+                auto const hash = parse_hash32(path_to_string(it->path().stem()));
+                if (!hash) continue;
+
+                std::error_code sizeEc;
+                uint64_t const size = it->file_size(sizeEc);
+                if (sizeEc) continue;
+
+                list.files.push_back({ *hash, path_to_string(it->path().filename()), size });
+            }
+        }
+
+        if (pending->cancelled.load(std::memory_order_relaxed)) return;
+        if (!table->reused) save_file_list(indexPath, list);
+
+        table->paths.reserve(list.files.size());
+        table->hashes.reserve(list.files.size());
+        for (auto const& entry : list.files) {
+            table->paths.push_back(directory / std::filesystem::path(std::u8string(entry.name.begin(), entry.name.end())));
+            table->hashes.push_back(entry.hash);
+            table->bytes += entry.size;
+        }
+        table->files.resize(list.files.size());
+
+        // At most half full so misses end after a probe or two
+        size_t const capacity = std::bit_ceil(std::max<size_t>(table->paths.size() * 2, 16));
+        table->slots.resize(capacity);
+        table->mask = capacity - 1;
+
+        for (size_t i = 0; i < table->hashes.size(); ++i) {
+            uint32_t const hash = table->hashes[i];
+
+            size_t slot = hash & table->mask;
+            while (table->slots[slot].file != 0 && table->slots[slot].hash != hash)
+                slot = (slot + 1) & table->mask;
+
+            // Two names for one hash keep the first
+            if (table->slots[slot].file == 0) table->slots[slot] = { hash, static_cast<uint32_t>(i + 1) };
+        }
+
+        {
+            std::lock_guard lock(pending->mutex);
+            pending->table = std::move(table);
+            pending->finished = true;
+        }
+
+        wake_main_thread();
+    });
+}
+
+void GameCache::cancel() {
+    if (!mPending) return;
+
+    mPending->cancelled.store(true, std::memory_order_relaxed);
+    mPending.reset();
+}
+
+bool GameCache::poll() {
+    if (!mPending) return false;
+
+    {
+        std::lock_guard lock(mPending->mutex);
+        if (!mPending->finished) return false;
+        mTable = std::move(mPending->table);
+    }
+
+    mPending.reset();
+    return true;
+}
+
+std::span<std::byte const> GameCache::find(uint32_t hash) const {
+    if (!mTable) return {};
+    Table::Slot const* slot = mTable->find(hash);
+    if (!slot) return {};
+
+    // A file that failed to map is tried again on the next lookup
+    MappedFile& file = mTable->files[slot->file - 1];
+    if (!file.is_open() && !file.open(mTable->paths[slot->file - 1])) return {};
+    return file.bytes();
+}
+
+std::span<std::byte const> GameCache::find(std::string_view name) const {
+    return find(hash32(name));
+}
+
+bool GameCache::contains(uint32_t hash) const {
+    return mTable && mTable->find(hash) != nullptr;
+}
+
+std::vector<uint32_t> GameCache::hashes() const {
+    return mTable ? mTable->hashes : std::vector<uint32_t>();
+}
+
+size_t GameCache::size() const {
+    return mTable ? mTable->paths.size() : 0;
+}
+
+uint64_t GameCache::bytes() const {
+    return mTable ? mTable->bytes : 0;
+}
+
+bool GameCache::reused() const {
+    return mTable && mTable->reused;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "te_mapped_file.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string_view>
+#include <vector>
+
+class ThreadPool;
+
+// Every file in the game's cache directory indexed by the hash32 its name encodes. Opening
+// runs on the pool and only lists the directory, a file is mapped the first time `find` asks
+// for it and the view points straight into the mapping. The file list is kept on disk and
+// reused as long as the directory's own mtime has not moved, then opening reads just that.
+class GameCache final {
+public:
+    explicit GameCache(ThreadPool& pool);
+
+    GameCache(GameCache const&) = delete;
+    GameCache& operator=(GameCache const&) = delete;
+
+    // Replaces the current contents once finished, see `poll`. An open still in flight is
+    // abandoned without saving its file list.
+    void open(std::filesystem::path directory, std::filesystem::path indexPath);
+
+    // Abandons an open in flight, the current contents stay
+    void cancel();
+
+    // Returns true when an open finished and its files became visible
+    bool poll();
+
+    inline bool loading() const { return mPending != nullptr; }
+
+    // Empty when no file has this hash or it cannot be mapped, views stay valid until the
+    // next open finishes. Main thread only, the first lookup of a file maps it.
+    std::span<std::byte const> find(uint32_t hash) const;
+    std::span<std::byte const> find(std::string_view name) const;
+    bool contains(uint32_t hash) const;
+
+    // Hash of every cached file
+    std::vector<uint32_t> hashes() const;
+
+    size_t size() const;
+    // As listed, a file rewritten since is not looked at again
+    uint64_t bytes() const;
+    // True if the last open reused the saved file list
+    bool reused() const;
+private:
+    struct Table {
+        struct Slot {
+            uint32_t hash = 0;
+            // Index into `files` plus one, zero marks an empty slot
+            uint32_t file = 0;
+        };
+
+        std::vector<std::filesystem::path> paths;
+        // Parallel to `paths`, opened on first use
+        mutable std::vector<MappedFile> files;
+        std::vector<uint32_t> hashes;
+        std::vector<Slot> slots;
+        size_t mask = 0;
+        uint64_t bytes = 0;
+        bool reused = false;
+
+        Slot const* find(uint32_t hash) const;
+    };
+
+    struct Pending {
+        std::atomic<bool> cancelled = false;
+        std::mutex mutex;
+        bool finished = false;
+        std::unique_ptr<Table> table;
+    };
+
+    ThreadPool& mPool;
+    std::unique_ptr<Table> mTable;
+    std::shared_ptr<Pending> mPending;
+};
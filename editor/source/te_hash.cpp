@@ -0,0 +1,536 @@
+#include "te_hash.hpp"
+#include "te_known_names.hpp"
+#include "te_profiler.hpp"
+#include "te_util.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <utility>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#   define TE_HASH_X86
+#   include <immintrin.h>
+#   ifdef _MSC_VER
+#       include <intrin.h>
+#       define TE_TARGET(x)
+#   else
+#       define TE_TARGET(x) __attribute__((target(x)))
+#   endif
+#endif
+
+// Pinned so a change to the shared loop cannot go unnoticed
+static_assert(""_h32 == 0x5902879e);
+static_assert("Alevels/demo.objlib"_h32 == 0x673863f9);
+static_assert(hash32("LEVEL DETAILS.txt") == 0x144209a7);
+
+std::optional<uint32_t> parse_hash32(std::string_view text) {
+    if (text.starts_with("0x") || text.starts_with("0X")) text.remove_prefix(2);
+    if (text.empty()) return std::nullopt;
+
+    uint32_t hash;
+    auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), hash, 16);
+    if (ec != std::errc() || ptr != text.data() + text.size()) return std::nullopt;
+    return hash;
+}
+
+namespace {
+    int64_t now_ns() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    void hash32_batch_scalar(std::string_view const* inputs, uint32_t* outputs, size_t count) {
+        for (size_t i = 0; i < count; ++i)
+            outputs[i] = hash32(inputs[i]);
+    }
+
+#ifdef TE_HASH_X86
+    inline uint32_t load_u32(unsigned char const* ptr) {
+        uint32_t value;
+        std::memcpy(&value, ptr, sizeof(value));
+        return value;
+    }
+
+    // Each lane hashes its own string, the shared prefix up to the shortest string
+    // runs unmasked 4 bytes at a time and the ragged tail is blended per lane.
+    // Several vectors are kept in flight since the multiply latency dominates.
+    constexpr size_t kInterleave = 4;
+
+    TE_TARGET("sse4.1")
+    void hash32_group_sse41(std::string_view const* inputs, uint32_t* outputs, size_t count) {
+        constexpr size_t kLanes = 4;
+        constexpr size_t kStrings = kLanes * kInterleave;
+
+        unsigned char const* ptrs[kStrings];
+        alignas(16) uint32_t lengths[kStrings];
+        size_t minLength = SIZE_MAX, maxLength = 0;
+
+        for (size_t lane = 0; lane < kStrings; ++lane) {
+            // Partial groups repeat their last input, the extra results are discarded
+            std::string_view const str = inputs[std::min(lane, count - 1)];
+            ptrs[lane] = reinterpret_cast<unsigned char const*>(str.data());
+            lengths[lane] = static_cast<uint32_t>(str.size());
+            minLength = std::min(minLength, str.size());
+            maxLength = std::max(maxLength, str.size());
+        }
+
+        __m128i const prime = _mm_set1_epi32(0x1000193);
+        __m128i const byteMask = _mm_set1_epi32(0xff);
+        __m128i h[kInterleave];
+        for (auto& v : h) v = _mm_set1_epi32(static_cast<int>(0x811c9dc5));
+
+        size_t i = 0;
+        for (; i + 4 <= minLength; i += 4) {
+            for (size_t g = 0; g < kInterleave; ++g) {
+                unsigned char const* const* p = ptrs + g * kLanes;
+                __m128i const words = _mm_setr_epi32(load_u32(p[0] + i), load_u32(p[1] + i), load_u32(p[2] + i), load_u32(p[3] + i));
+                h[g] = _mm_mullo_epi32(_mm_xor_si128(h[g], _mm_and_si128(words, byteMask)), prime);
+                h[g] = _mm_mullo_epi32(_mm_xor_si128(h[g], _mm_and_si128(_mm_srli_epi32(words, 8), byteMask)), prime);
+                h[g] = _mm_mullo_epi32(_mm_xor_si128(h[g], _mm_and_si128(_mm_srli_epi32(words, 16), byteMask)), prime);
+                h[g] = _mm_mullo_epi32(_mm_xor_si128(h[g], _mm_srli_epi32(words, 24)), prime);
+            }
+        }
+
+        for (; i < minLength; ++i) {
+            for (size_t g = 0; g < kInterleave; ++g) {
+                unsigned char const* const* p = ptrs + g * kLanes;
+                __m128i const bytes = _mm_setr_epi32(p[0][i], p[1][i], p[2][i], p[3][i]);
+                h[g] = _mm_mullo_epi32(_mm_xor_si128(h[g], bytes), prime);
+            }
+        }
+
+        for (; i < maxLength; ++i) {
+            alignas(16) uint32_t bytes[kStrings];
+            for (size_t lane = 0; lane < kStrings; ++lane)
+                bytes[lane] = i < lengths[lane] ? ptrs[lane][i] : 0;
+
+            for (size_t g = 0; g < kInterleave; ++g) {
+                __m128i const next = _mm_mullo_epi32(_mm_xor_si128(h[g], _mm_load_si128(reinterpret_cast<__m128i const*>(bytes + g * kLanes))), prime);
+                __m128i const active = _mm_cmpgt_epi32(_mm_load_si128(reinterpret_cast<__m128i const*>(lengths + g * kLanes)), _mm_set1_epi32(static_cast<int>(i)));
+                h[g] = _mm_blendv_epi8(h[g], next, active);
+            }
+        }
+
+        alignas(16) uint32_t result[kStrings];
+        for (size_t g = 0; g < kInterleave; ++g) {
+            h[g] = _mm_mullo_epi32(h[g], _mm_set1_epi32(0x2001));
+            h[g] = _mm_mullo_epi32(_mm_xor_si128(h[g], _mm_srli_epi32(h[g], 0x7)), _mm_set1_epi32(0x9));
+            h[g] = _mm_mullo_epi32(_mm_xor_si128(h[g], _mm_srli_epi32(h[g], 0x11)), _mm_set1_epi32(0x21));
+            _mm_store_si128(reinterpret_cast<__m128i*>(result + g * kLanes), h[g]);
+        }
+
+        std::memcpy(outputs, result, count * sizeof(uint32_t));
+    }
+
+    TE_TARGET("avx2")
+    void hash32_group_avx2(std::string_view const* inputs, uint32_t* outputs, size_t count) {
+        constexpr size_t kLanes = 8;
+        constexpr size_t kStrings = kLanes * kInterleave;
+
+        unsigned char const* ptrs[kStrings];
+        alignas(32) uint32_t lengths[kStrings];
+        size_t minLength = SIZE_MAX, maxLength = 0;
+
+        for (size_t lane = 0; lane < kStrings; ++lane) {
+            std::string_view const str = inputs[std::min(lane, count - 1)];
+            ptrs[lane] = reinterpret_cast<unsigned char const*>(str.data());
+            lengths[lane] = static_cast<uint32_t>(str.size());
+            minLength = std::min(minLength, str.size());
+            maxLength = std::max(maxLength, str.size());
+        }
+
+        __m256i const prime = _mm256_set1_epi32(0x1000193);
+        __m256i const byteMask = _mm256_set1_epi32(0xff);
+        __m256i h[kInterleave];
+        for (auto& v : h) v = _mm256_set1_epi32(static_cast<int>(0x811c9dc5));
+
+        size_t i = 0;
+        for (; i + 4 <= minLength; i += 4) {
+            for (size_t g = 0; g < kInterleave; ++g) {
+                unsigned char const* const* p = ptrs + g * kLanes;
+                __m256i const words = _mm256_setr_epi32(
+                    load_u32(p[0] + i), load_u32(p[1] + i), load_u32(p[2] + i), load_u32(p[3] + i),
+                    load_u32(p[4] + i), load_u32(p[5] + i), load_u32(p[6] + i), load_u32(p[7] + i)
+                );
+                h[g] = _mm256_mullo_epi32(_mm256_xor_si256(h[g], _mm256_and_si256(words, byteMask)), prime);
+                h[g] = _mm256_mullo_epi32(_mm256_xor_si256(h[g], _mm256_and_si256(_mm256_srli_epi32(words, 8), byteMask)), prime);
+                h[g] = _mm256_mullo_epi32(_mm256_xor_si256(h[g], _mm256_and_si256(_mm256_srli_epi32(words, 16), byteMask)), prime);
+                h[g] = _mm256_mullo_epi32(_mm256_xor_si256(h[g], _mm256_srli_epi32(words, 24)), prime);
+            }
+        }
+
+        for (; i < minLength; ++i) {
+            for (size_t g = 0; g < kInterleave; ++g) {
+                unsigned char const* const* p = ptrs + g * kLanes;
+                __m256i const bytes = _mm256_setr_epi32(p[0][i], p[1][i], p[2][i], p[3][i], p[4][i], p[5][i], p[6][i], p[7][i]);
+                h[g] = _mm256_mullo_epi32(_mm256_xor_si256(h[g], bytes), prime);
+            }
+        }
+
+        for (; i < maxLength; ++i) {
+            alignas(32) uint32_t bytes[kStrings];
+            for (size_t lane = 0; lane < kStrings; ++lane)
+                bytes[lane] = i < lengths[lane] ? ptrs[lane][i] : 0;
+
+            for (size_t g = 0; g < kInterleave; ++g) {
+                __m256i const next = _mm256_mullo_epi32(_mm256_xor_si256(h[g], _mm256_load_si256(reinterpret_cast<__m256i const*>(bytes + g * kLanes))), prime);
+                __m256i const active = _mm256_cmpgt_epi32(_mm256_load_si256(reinterpret_cast<__m256i const*>(lengths + g * kLanes)), _mm256_set1_epi32(static_cast<int>(i)));
+                h[g] = _mm256_blendv_epi8(h[g], next, active);
+            }
+        }
+
+        alignas(32) uint32_t result[kStrings];
+        for (size_t g = 0; g < kInterleave; ++g) {
+            h[g] = _mm256_mullo_epi32(h[g], _mm256_set1_epi32(0x2001));
+            h[g] = _mm256_mullo_epi32(_mm256_xor_si256(h[g], _mm256_srli_epi32(h[g], 0x7)), _mm256_set1_epi32(0x9));
+            h[g] = _mm256_mullo_epi32(_mm256_xor_si256(h[g], _mm256_srli_epi32(h[g], 0x11)), _mm256_set1_epi32(0x21));
+            _mm256_store_si256(reinterpret_cast<__m256i*>(result + g * kLanes), h[g]);
+        }
+
+        std::memcpy(outputs, result, count * sizeof(uint32_t));
+    }
+
+    // Lanes only run unmasked while every string in the group still has bytes left,
+    // so inputs are counting sorted by length in cache sized chunks to make groups uniform.
+    // Strings under 16 bytes stay scalar, the out of order core overlaps those better than
+    // the transpose into lanes costs.
+    constexpr size_t kSortChunk = 4096;
+    constexpr size_t kSimdMinLength = 16;
+    constexpr size_t kBuckets = 64;
+
+    void hash32_batch_sorted(std::string_view const* inputs, uint32_t* outputs, size_t count, HashIsa isa) {
+        std::string_view sortedInputs[kSortChunk];
+        uint32_t sortedOutputs[kSortChunk];
+        uint16_t order[kSortChunk];
+
+        size_t offsets[kBuckets + 1] = {};
+        for (size_t i = 0; i < count; ++i) {
+            if (inputs[i].size() < kSimdMinLength) outputs[i] = hash32(inputs[i]);
+            else ++offsets[std::min(inputs[i].size(), kBuckets - 1) + 1];
+        }
+
+        for (size_t i = 1; i <= kBuckets; ++i)
+            offsets[i] += offsets[i - 1];
+
+        size_t const sorted = offsets[kBuckets];
+        for (size_t i = 0; i < count; ++i) {
+            if (inputs[i].size() < kSimdMinLength) continue;
+            size_t const slot = offsets[std::min(inputs[i].size(), kBuckets - 1)]++;
+            sortedInputs[slot] = inputs[i];
+            order[slot] = static_cast<uint16_t>(i);
+        }
+
+        if (isa == HashIsa::Avx2) {
+            for (size_t i = 0; i < sorted; i += 8 * kInterleave)
+                hash32_group_avx2(sortedInputs + i, sortedOutputs + i, std::min<size_t>(8 * kInterleave, sorted - i));
+        }
+        else {
+            for (size_t i = 0; i < sorted; i += 4 * kInterleave)
+                hash32_group_sse41(sortedInputs + i, sortedOutputs + i, std::min<size_t>(4 * kInterleave, sorted - i));
+        }
+
+        for (size_t i = 0; i < sorted; ++i)
+            outputs[order[i]] = sortedOutputs[i];
+    }
+#endif
+}
+
+HashIsa hash32_detect_isa() {
+    static HashIsa const isa = []() -> HashIsa {
+#ifdef TE_HASH_X86
+#   ifdef _MSC_VER
+        int info[4];
+        __cpuid(info, 0);
+        int const maxLeaf = info[0];
+
+        __cpuid(info, 1);
+        bool const sse41 = info[2] & (1 << 19);
+        bool const osxsave = info[2] & (1 << 27);
+
+        bool avx2 = false;
+        if (maxLeaf >= 7 && osxsave && (_xgetbv(0) & 0x6) == 0x6) {
+            __cpuidex(info, 7, 0);
+            avx2 = info[1] & (1 << 5);
+        }
+#   else
+        __builtin_cpu_init();
+        bool const sse41 = __builtin_cpu_supports("sse4.1");
+        bool const avx2 = __builtin_cpu_supports("avx2");
+#   endif
+        if (avx2) return HashIsa::Avx2;
+        if (sse41) return HashIsa::Sse41;
+#endif
+        return HashIsa::Scalar;
+    }();
+
+    return isa;
+}
+
+char const* hash32_isa_name(HashIsa isa) {
+    switch (isa) {
+    case HashIsa::Avx2: return "AVX2";
+    case HashIsa::Sse41: return "SSE4.1";
+    default: return "Scalar";
+    }
+}
+
+void hash32_batch(std::span<std::string_view const> inputs, std::span<uint32_t> outputs, HashIsa isa) {
+    size_t const count = std::min(inputs.size(), outputs.size());
+
+#ifdef TE_HASH_X86
+    if (isa != HashIsa::Scalar) {
+        for (size_t i = 0; i < count; i += kSortChunk) {
+            size_t const size = std::min(kSortChunk, count - i);
+            hash32_batch_sorted(inputs.data() + i, outputs.data() + i, size, isa);
+        }
+        return;
+    }
+#endif
+
+    hash32_batch_scalar(inputs.data(), outputs.data(), count);
+}
+
+void hash32_batch(std::span<std::string_view const> inputs, std::span<uint32_t> outputs) {
+    hash32_batch(inputs, outputs, hash32_detect_isa());
+}
+
+void hash32_batch_parallel(std::span<std::string_view const> inputs, std::span<uint32_t> outputs, unsigned int threadCount) {
+    // Below this the thread startup costs more than the hashing
+    constexpr size_t kMinPerThread = 16384;
+
+    size_t const count = std::min(inputs.size(), outputs.size());
+    if (threadCount == 0) threadCount = std::max(1u, std::thread::hardware_concurrency());
+    threadCount = static_cast<unsigned int>(std::min<size_t>(threadCount, std::max<size_t>(1, count / kMinPerThread)));
+
+    if (threadCount <= 1) {
+        hash32_batch(inputs.first(count), outputs.first(count));
+        return;
+    }
+
+    // Keep chunks a multiple of the widest lane count so only the final group is partial
+    size_t const chunk = ((count + threadCount - 1) / threadCount + 7) & ~size_t(7);
+
+    std::vector<std::thread> threads;
+    threads.reserve(threadCount - 1);
+
+    for (size_t begin = chunk; begin < count; begin += chunk) {
+        size_t const size = std::min(chunk, count - begin);
+        threads.emplace_back([=]() { hash32_batch(inputs.subspan(begin, size), outputs.subspan(begin, size)); });
+    }
+
+    hash32_batch(inputs.first(std::min(chunk, count)), outputs.first(std::min(chunk, count)));
+
+    for (auto& thread : threads)
+        thread.join();
+}
+
+bool HashDictionary::add(std::string_view name) {
+    return add(hash32(name), name);
+}
+
+bool HashDictionary::add(uint32_t hash, std::string_view name) {
+    auto& names = mNames[hash];
+    if (std::find(names.begin(), names.end(), name) != names.end()) return false;
+
+    names.emplace_back(name);
+    ++mCount;
+    mDirty = true;
+    return true;
+}
+
+std::vector<std::string_view> HashDictionary::find(uint32_t hash) const {
+    std::vector<std::string_view> names;
+    auto const known = known_name(hash);
+    if (known) names.push_back(*known);
+
+    if (auto it = mNames.find(hash); it != mNames.end()) {
+        for (auto const& name : it->second)
+            if (!known || name != *known) names.emplace_back(name);
+    }
+
+    return names;
+}
+
+bool HashDictionary::contains(uint32_t hash) const {
+    return known_name(hash).has_value() || mNames.contains(hash);
+}
+
+bool HashDictionary::load(std::filesystem::path const& path) {
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    if (!file) return false;
+
+    std::string line;
+    while (std::getline(file, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.size() < 10 || line[8] != ' ') continue;
+
+        uint32_t hash;
+        auto [ptr, ec] = std::from_chars(line.data(), line.data() + 8, hash, 16);
+        if (ec != std::errc() || ptr != line.data() + 8) continue;
+
+        add(hash, std::string_view(line).substr(9));
+    }
+
+    mDirty = false;
+    return true;
+}
+
+bool HashDictionary::save(std::filesystem::path const& path) {
+    std::vector<std::pair<uint32_t, std::string const*>> entries;
+    entries.reserve(mCount);
+    for (auto const& [hash, names] : mNames)
+        for (auto const& name : names)
+            entries.emplace_back(hash, &name);
+
+    // Sorted so the file diffs cleanly between sessions
+    std::sort(entries.begin(), entries.end(), [](auto const& a, auto const& b) {
+        return a.first != b.first ? a.first < b.first : *a.second < *b.second;
+    });
+
+    std::ofstream file(path, std::ios::out | std::ios::binary);
+    if (!file) return false;
+
+    char hex[10];
+    for (auto const& [hash, name] : entries) {
+        snprintf(hex, sizeof(hex), "%08x ", hash);
+        file.write(hex, 9);
+        file.write(name->data(), name->size());
+        file.put('\n');
+    }
+
+    if (!file) return false;
+    mDirty = false;
+    return true;
+}
+
+void HashSearch::start(std::vector<std::string> prefixes, std::vector<std::string> words, std::vector<std::string> suffixes, std::unordered_set<uint32_t> targets, unsigned int threadCount) {
+    cancel();
+
+    // Missing parts behave as a single empty string so plain wordlists work unchanged
+    if (prefixes.empty()) prefixes.emplace_back();
+    if (suffixes.empty()) suffixes.emplace_back();
+
+    mPrefixes = std::move(prefixes);
+    mWords = std::move(words);
+    mSuffixes = std::move(suffixes);
+    mTargets = std::move(targets);
+    mMatches.clear();
+    mKept = 0;
+    mDropped = 0;
+
+    mTotal = static_cast<uint64_t>(mPrefixes.size()) * mWords.size() * mSuffixes.size();
+    mNext = 0;
+    mProcessed = 0;
+    mCancel = false;
+    mStartTime = now_ns();
+    mEndTime = 0;
+
+    if (mTotal == 0) return;
+
+    if (threadCount == 0) threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+    mRunning = true;
+    mActive = threadCount;
+    for (unsigned int i = 0; i < threadCount; ++i)
+        mThreads.emplace_back(&HashSearch::worker, this);
+}
+
+void HashSearch::cancel() {
+    mCancel = true;
+    for (auto& thread : mThreads)
+        thread.join();
+    mThreads.clear();
+    mRunning = false;
+}
+
+double HashSearch::hashes_per_second() const {
+    int64_t end = mEndTime.load(std::memory_order_acquire);
+    if (end == 0) end = now_ns();
+    if (end <= mStartTime) return 0.0;
+    return static_cast<double>(processed()) * 1e9 / static_cast<double>(end - mStartTime);
+}
+
+std::vector<HashSearch::Match> HashSearch::take_matches() {
+    std::lock_guard lock(mMatchMutex);
+    return std::exchange(mMatches, {});
+}
+
+void HashSearch::worker() {
+    TE_PROFILE_THREAD("Hash Search");
+
+    constexpr uint64_t kBlockSize = 4096;
+
+    std::string buffer;
+    std::vector<size_t> offsets;
+    std::vector<std::string_view> candidates;
+    std::vector<uint32_t> hashes;
+    std::vector<Match> found;
+
+    offsets.reserve(kBlockSize + 1);
+    candidates.reserve(kBlockSize);
+    hashes.resize(kBlockSize);
+
+    uint64_t const suffixCount = mSuffixes.size();
+    uint64_t const wordCount = mWords.size();
+
+    while (!mCancel.load(std::memory_order_relaxed)) {
+        uint64_t const begin = mNext.fetch_add(kBlockSize, std::memory_order_relaxed);
+        if (begin >= mTotal) break;
+        uint64_t const end = std::min(begin + kBlockSize, mTotal);
+        TE_PROFILE_ZONE("Hash Search Block");
+
+        // Build the whole block into one buffer first, views are taken after it stops growing
+        buffer.clear();
+        offsets.clear();
+        for (uint64_t index = begin; index < end; ++index) {
+            uint64_t const suffix = index % suffixCount;
+            uint64_t const word = (index / suffixCount) % wordCount;
+            uint64_t const prefix = index / suffixCount / wordCount;
+
+            offsets.push_back(buffer.size());
+            buffer += mPrefixes[prefix];
+            buffer += mWords[word];
+            buffer += mSuffixes[suffix];
+        }
+        offsets.push_back(buffer.size());
+
+        candidates.clear();
+        for (size_t i = 0; i + 1 < offsets.size(); ++i)
+            candidates.emplace_back(buffer.data() + offsets[i], offsets[i + 1] - offsets[i]);
+
+        hash32_batch(candidates, std::span(hashes).first(candidates.size()));
+
+        // Once the cap is reached matches are only counted, no strings are built for them
+        bool const full = mKept.load(std::memory_order_relaxed) >= kMaxMatches;
+        uint64_t dropped = 0;
+        for (size_t i = 0; i < candidates.size(); ++i) {
+            if (!mTargets.empty() && !mTargets.contains(hashes[i])) continue;
+            if (full) ++dropped;
+            else found.emplace_back(hashes[i], std::string(candidates[i]));
+        }
+
+        if (!found.empty()) {
+            uint64_t const kept = mKept.fetch_add(found.size(), std::memory_order_relaxed);
+            size_t const room = kept < kMaxMatches ? static_cast<size_t>(std::min<uint64_t>(found.size(), kMaxMatches - kept)) : 0;
+            dropped += found.size() - room;
+            found.resize(room);
+
+            std::lock_guard lock(mMatchMutex);
+            mMatches.insert(mMatches.end(), std::make_move_iterator(found.begin()), std::make_move_iterator(found.end()));
+            found.clear();
+        }
+
+        if (dropped > 0) mDropped.fetch_add(dropped, std::memory_order_relaxed);
+
+        mProcessed.fetch_add(end - begin, std::memory_order_relaxed);
+    }
+
+    if (mActive.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        mEndTime.store(now_ns(), std::memory_order_release);
+        mRunning.store(false, std::memory_order_release);
+        wake_main_thread();
+    }
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <span>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <filesystem>
+#include <atomic>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+// Thumper names its cache files by this hash of the asset path. Both overloads run the same
+// loop, at compile time or at runtime, so a constant hash always equals the runtime one.
+template <typename Byte>
+constexpr uint32_t hash32_bytes(Byte const* array, size_t size) {
+    uint32_t h = 0x811c9dc5;
+
+    for (size_t i = 0; i < size; ++i)
+        h = (h ^ static_cast<unsigned char>(array[i])) * 0x1000193;
+
+    h *= 0x2001;
+    h = (h ^ (h >> 0x7)) * 0x9;
+    h = (h ^ (h >> 0x11)) * 0x21;
+
+    return h;
+}
+
+inline uint32_t hash32(unsigned char const* array, unsigned int size) {
+    return hash32_bytes(array, size);
+}
+
+constexpr uint32_t hash32(std::string_view str) {
+    return hash32_bytes(str.data(), str.size());
+}
+
+// `"Alevels/demo.objlib"_h32` is folded into a constant, no hashing happens at runtime
+consteval uint32_t operator""_h32(char const* str, size_t size) {
+    return hash32_bytes(str, size);
+}
+
+// Accepts hex with or without a `0x` prefix
+std::optional<uint32_t> parse_hash32(std::string_view text);
+
+enum class HashIsa {
+    Scalar,
+    Sse41,
+    Avx2,
+};
+
+// Best instruction set supported by this cpu and os
+HashIsa hash32_detect_isa();
+char const* hash32_isa_name(HashIsa isa);
+
+// Hashes every input into the matching output slot, results are bit-identical to `hash32`.
+// Inputs are processed in groups of 4 (SSE4.1) or 8 (AVX2) strings, one string per lane.
+void hash32_batch(std::span<std::string_view const> inputs, std::span<uint32_t> outputs, HashIsa isa);
+void hash32_batch(std::span<std::string_view const> inputs, std::span<uint32_t> outputs);
+
+// Same as above split across `threadCount` threads, 0 uses every core
+void hash32_batch_parallel(std::span<std::string_view const> inputs, std::span<uint32_t> outputs, unsigned int threadCount = 0);
+
+// Persistent hash -> name lookup, a hash may resolve to more than one name on collisions
+class HashDictionary final {
+public:
+    // Returns false if the name was already known
+    bool add(std::string_view name);
+    bool add(uint32_t hash, std::string_view name);
+
+    // Names from `kKnownNames` come first, they need no dictionary file
+    std::vector<std::string_view> find(uint32_t hash) const;
+    bool contains(uint32_t hash) const;
+
+    inline size_t size() const { return mCount; }
+    inline bool dirty() const { return mDirty; }
+
+    // Plain text, one `xxxxxxxx name` entry per line
+    bool load(std::filesystem::path const& path);
+    bool save(std::filesystem::path const& path);
+private:
+    std::unordered_map<uint32_t, std::vector<std::string>> mNames;
+    size_t mCount = 0;
+    bool mDirty = false;
+};
+
+// Hashes every `prefix + word + suffix` combination on a background thread pool.
+// With a non-empty target set only candidates hitting one of those hashes are kept.
+// At most `kMaxMatches` are kept per search, without targets every candidate matches
+// and the rest are only counted.
+class HashSearch final {
+public:
+    struct Match {
+        uint32_t hash;
+        std::string name;
+    };
+
+    static constexpr uint64_t kMaxMatches = 100000;
+
+    HashSearch() = default;
+    ~HashSearch() noexcept { cancel(); }
+
+    HashSearch(HashSearch const&) = delete;
+    HashSearch& operator=(HashSearch const&) = delete;
+
+    void start(std::vector<std::string> prefixes, std::vector<std::string> words, std::vector<std::string> suffixes, std::unordered_set<uint32_t> targets, unsigned int threadCount = 0);
+    void cancel();
+
+    inline bool running() const { return mRunning.load(std::memory_order_acquire); }
+    inline uint64_t total() const { return mTotal; }
+    inline uint64_t processed() const { return mProcessed.load(std::memory_order_relaxed); }
+    // Matches past `kMaxMatches` that were thrown away
+    inline uint64_t dropped() const { return mDropped.load(std::memory_order_relaxed); }
+    double hashes_per_second() const;
+
+    // Moves any matches found so far out of the search
+    std::vector<Match> take_matches();
+private:
+    void worker();
+
+    std::vector<std::string> mPrefixes, mWords, mSuffixes;
+    std::unordered_set<uint32_t> mTargets;
+    std::vector<std::thread> mThreads;
+
+    std::atomic<uint64_t> mNext = 0;
+    std::atomic<uint64_t> mProcessed = 0;
+    std::atomic<uint64_t> mKept = 0;
+    std::atomic<uint64_t> mDropped = 0;
+    std::atomic<unsigned int> mActive = 0;
+    std::atomic<bool> mRunning = false;
+    std::atomic<bool> mCancel = false;
+    uint64_t mTotal = 0;
+    int64_t mStartTime = 0;
+    std::atomic<int64_t> mEndTime = 0;
+
+    std::mutex mMatchMutex;
+    std::vector<Match> mMatches;
+};
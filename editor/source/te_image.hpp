@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stb_image.h>
+
+#include <cstddef>
+#include <cstdlib>
+#include <utility>
+
+// Decoded RGBA8 pixels, safe to construct on any thread
+class Image final {
+public:
+    constexpr Image() = default;
+    Image(char const* aPath) {
+        mPixels = stbi_load(aPath, &mWidth, &mHeight, nullptr, 4);
+    }
+
+    Image(unsigned char const* aData, size_t aSize) {
+        mPixels = stbi_load_from_memory(aData, static_cast<int>(aSize), &mWidth, &mHeight, nullptr, 4);
+    }
+
+    // Uninitialized pixels, allocated with malloc to match `stbi_image_free`
+    Image(int aWidth, int aHeight) : mWidth(aWidth), mHeight(aHeight) {
+        mPixels = static_cast<stbi_uc*>(std::malloc(static_cast<size_t>(aWidth) * aHeight * 4));
+    }
+
+    ~Image() noexcept {
+        stbi_image_free(mPixels);
+    }
+
+    Image(Image const&) = delete;
+    Image& operator=(Image const&) = delete;
+
+    Image(Image&& other) noexcept { *this = std::move(other); }
+    Image& operator=(Image&& other) noexcept {
+        std::swap(mWidth, other.mWidth);
+        std::swap(mHeight, other.mHeight);
+        std::swap(mPixels, other.mPixels);
+        return *this;
+    }
+
+    inline int width() const { return mWidth; }
+    inline int height() const { return mHeight; }
+    inline stbi_uc* pixels() const { return mPixels; }
+private:
+    int mWidth = 0, mHeight = 0;
+    stbi_uc* mPixels = nullptr;
+};
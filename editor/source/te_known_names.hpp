@@ -0,0 +1,137 @@
+#pragma once
+
+#include "te_hash.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+
+// Perfect hash from hash32 back to a fixed set of names, built entirely by the compiler.
+// Names are split into small buckets and each bucket searches a seed that moves all its
+// names into free slots, biggest buckets first. The search stays linear in the number of
+// names, so the list can grow to thousands. A lookup is two multiplies, one compare and no
+// allocation.
+template <size_t N>
+class KnownNameTable final {
+public:
+    struct Slot {
+        std::string_view name;
+        uint32_t hash = 0;
+    };
+
+    // At least twice as many slots as names, and about two names per bucket
+    static constexpr size_t kBits = std::bit_width(2 * N - 1);
+    static constexpr size_t kSlotCount = size_t(1) << kBits;
+    static constexpr size_t kBucketBits = kBits > 2 ? kBits - 2 : 0;
+    static constexpr size_t kBucketCount = size_t(1) << kBucketBits;
+    static constexpr uint32_t kMaxSeed = 1 << 16;
+
+    consteval explicit KnownNameTable(std::array<std::string_view, N> const& names) {
+        std::array<uint32_t, N> hashes{};
+        for (size_t i = 0; i < N; ++i)
+            hashes[i] = hash32(names[i]);
+
+        // Counting sort of the names by bucket
+        std::array<size_t, kBucketCount + 1> starts{};
+        for (uint32_t hash : hashes)
+            ++starts[bucket_of(hash) + 1];
+        for (size_t bucket = 0; bucket < kBucketCount; ++bucket)
+            starts[bucket + 1] += starts[bucket];
+
+        std::array<size_t, kBucketCount> filled{};
+        std::array<size_t, N> members{};
+        for (size_t i = 0; i < N; ++i) {
+            size_t const bucket = bucket_of(hashes[i]);
+            members[starts[bucket] + filled[bucket]++] = i;
+        }
+
+        size_t largest = 0;
+        for (size_t bucket = 0; bucket < kBucketCount; ++bucket)
+            largest = std::max(largest, starts[bucket + 1] - starts[bucket]);
+
+        mValid = true;
+        for (size_t size = largest; size > 0 && mValid; --size) {
+            for (size_t bucket = 0; bucket < kBucketCount && mValid; ++bucket) {
+                if (starts[bucket + 1] - starts[bucket] != size) continue;
+                mValid = place(bucket, names, hashes, std::span<size_t const>(members).subspan(starts[bucket], size));
+            }
+        }
+    }
+
+    // False when some bucket found no seed, checked by a static_assert next to the table
+    constexpr bool valid() const { return mValid; }
+    constexpr std::array<Slot, kSlotCount> const& slots() const { return mSlots; }
+
+    constexpr std::optional<std::string_view> name(uint32_t hash) const {
+        Slot const& slot = mSlots[slot_of(hash, mSeeds[bucket_of(hash)])];
+        if (slot.name.empty() || slot.hash != hash) return std::nullopt;
+        return slot.name;
+    }
+
+    // Hash of `name` only if it is one of the known names
+    constexpr std::optional<uint32_t> hash(std::string_view name) const {
+        uint32_t const hash = hash32(name);
+        if (this->name(hash) != name) return std::nullopt;
+        return hash;
+    }
+private:
+    static constexpr size_t bucket_of(uint32_t hash) {
+        if constexpr (kBucketBits == 0) return 0;
+        else return static_cast<size_t>((hash * 0x9e3779b1u) >> (32 - kBucketBits));
+    }
+
+    static constexpr size_t slot_of(uint32_t hash, uint32_t seed) {
+        uint32_t mixed = (hash ^ seed) * 0x85ebca6bu;
+        mixed ^= mixed >> 13;
+        return static_cast<size_t>((mixed * 0xc2b2ae35u) >> (32 - kBits));
+    }
+
+    // Claims a free slot for every name in the bucket under one seed, false if no seed fits
+    constexpr bool place(size_t bucket, std::array<std::string_view, N> const& names, std::array<uint32_t, N> const& hashes, std::span<size_t const> members) {
+        for (uint32_t seed = 0; seed < kMaxSeed; ++seed) {
+            bool fits = true;
+            for (size_t i = 0; i < members.size() && fits; ++i) {
+                size_t const slot = slot_of(hashes[members[i]], seed);
+                if (!mSlots[slot].name.empty()) fits = false;
+
+                // Two names with one hash32 can never be told apart, no seed helps then
+                for (size_t j = 0; j < i && fits; ++j)
+                    if (slot_of(hashes[members[j]], seed) == slot) fits = false;
+            }
+            if (!fits) continue;
+
+            mSeeds[bucket] = seed;
+            for (size_t member : members)
+                mSlots[slot_of(hashes[member], seed)] = { names[member], hashes[member] };
+            return true;
+        }
+
+        return false;
+    }
+
+    std::array<Slot, kSlotCount> mSlots{};
+    std::array<uint32_t, kBucketCount> mSeeds{};
+    bool mValid = false;
+};
+
+// Names from te_known_names.txt, add new ones there and the table rebuilds itself
+inline constexpr KnownNameTable kKnownNames(std::to_array<std::string_view>({
+#include "te_known_names.inc"
+}));
+
+static_assert(kKnownNames.valid(), "two known names share a hash32");
+static_assert(kKnownNames.hash("Alevels/demo.objlib") == "Alevels/demo.objlib"_h32);
+static_assert(!kKnownNames.name(""_h32));
+
+constexpr std::optional<std::string_view> known_name(uint32_t hash) {
+    return kKnownNames.name(hash);
+}
+
+constexpr std::optional<uint32_t> known_hash(std::string_view name) {
+    return kKnownNames.hash(name);
+}
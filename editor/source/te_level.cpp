@@ -0,0 +1,355 @@
+#include "te_level.hpp"
+#include "te_level_details.hpp"
+#include "te_level_table.hpp"
+#include "te_profiler.hpp"
+#include "te_thread_pool.hpp"
+#include "te_util.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <mutex>
+#include <unordered_map>
+
+namespace {
+    // Directories handed to each pool task
+    constexpr size_t kScanBatch = 32;
+}
+
+std::optional<Level> load_level(std::filesystem::path const& directory) {
+    TE_PROFILE_ZONE("Load Level");
+
+    std::filesystem::path path = directory / "LEVEL DETAILS.txt";
+
+    std::error_code ec;
+    uint64_t const size = std::filesystem::file_size(path, ec);
+    if (ec) return std::nullopt;
+    auto const modified = std::filesystem::last_write_time(path, ec);
+    if (ec) return std::nullopt;
+
+    // Reused by every load on this thread, details files are a few hundred bytes
+    thread_local std::string text;
+
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    if (!file) return std::nullopt;
+
+    text.resize(size);
+    file.read(text.data(), static_cast<std::streamsize>(size));
+    text.resize(static_cast<size_t>(file.gcount()));
+
+    Level level;
+    if (!parse_level_details(text, level)) return std::nullopt;
+
+    level.path = path_to_string(directory);
+    level.modified = modified.time_since_epoch().count();
+    level.size = size;
+    return level;
+}
+
+struct LevelLibrary::ScanState {
+    std::atomic<bool> cancelled = false;
+    std::atomic<bool> listed = false;
+    std::atomic<size_t> total = 0;
+    std::atomic<size_t> scanned = 0;
+
+    // Read only once the listing task has published it through `listed`
+    LevelList index;
+    std::unordered_map<std::string_view, uint32_t> lookup;
+    // The snapshot on disk was missing or damaged and has to be written again
+    bool rewrite = false;
+
+    std::mutex mutex;
+    // Levels that differ from the snapshot
+    std::vector<Level> pending;
+    // Path of every level that loaded, anything else is dropped once the scan finishes
+    std::vector<std::string> present;
+
+    bool finished() const {
+        return listed.load(std::memory_order_acquire) && scanned.load(std::memory_order_acquire) == total.load(std::memory_order_acquire);
+    }
+};
+
+struct LevelLibrary::RefreshState {
+    struct Update {
+        std::string path;
+
+        // Empty when the level no longer loads and should be dropped
+        std::optional<Level> level;
+    };
+
+    std::atomic<size_t> outstanding = 0;
+
+    std::mutex mutex;
+    std::vector<Update> pending;
+};
+
+LevelLibrary::LevelLibrary(ThreadPool& pool, std::filesystem::path root, std::filesystem::path indexPath)
+    : mPool(pool), mRoot(std::move(root)), mIndexPath(std::move(indexPath)), mRefresh(std::make_shared<RefreshState>()), mSaving(std::make_shared<std::atomic<bool>>(false)) {
+    // Checked in full by the next scan, until then damaged records just read as empty
+    if (!mIndexPath.empty()) mLevels.map(mIndexPath, false);
+}
+
+LevelLibrary::~LevelLibrary() noexcept {
+    cancel();
+}
+
+void LevelLibrary::cancel() {
+    if (!mScan) return;
+
+    mScan->cancelled = true;
+    mScan.reset();
+}
+
+void LevelLibrary::scan() {
+    cancel();
+
+    auto state = std::make_shared<ScanState>();
+    mScan = state;
+
+    mPool.submit([state, root = mRoot, indexPath = mIndexPath, &pool = mPool]() {
+        TE_PROFILE_ZONE("Level Scan");
+
+        // Mapped separately, the main thread's list may have moved on since it was saved
+        state->rewrite = !indexPath.empty() && !state->index.map(indexPath, true);
+        state->lookup.reserve(state->index.size());
+        for (size_t i = 0; i < state->index.size(); ++i)
+            state->lookup.emplace(state->index[i].path, static_cast<uint32_t>(i));
+
+        std::vector<std::filesystem::path> directories;
+        std::error_code ec;
+        for (auto it = std::filesystem::directory_iterator(root, ec); !ec && it != std::filesystem::directory_iterator(); it.increment(ec)) {
+            if (it->is_directory(ec)) directories.emplace_back(it->path());
+        }
+
+        state->total = directories.size();
+        state->listed.store(true, std::memory_order_release);
+        wake_main_thread();
+
+        for (size_t begin = 0; begin < directories.size(); begin += kScanBatch) {
+            if (state->cancelled.load(std::memory_order_relaxed)) return;
+
+            size_t const end = std::min(begin + kScanBatch, directories.size());
+            std::vector<std::filesystem::path> batch(std::make_move_iterator(directories.begin() + begin), std::make_move_iterator(directories.begin() + end));
+
+            pool.submit([state, batch = std::move(batch)]() {
+                TE_PROFILE_ZONE("Level Scan Batch");
+
+                std::vector<Level> results;
+                std::vector<std::string> present;
+                present.reserve(batch.size());
+
+                for (auto const& directory : batch) {
+                    if (state->cancelled.load(std::memory_order_relaxed)) break;
+
+                    std::filesystem::path details = directory / "LEVEL DETAILS.txt";
+                    std::error_code ec;
+                    uint64_t const size = std::filesystem::file_size(details, ec);
+                    if (ec) continue;
+                    int64_t const modified = std::filesystem::last_write_time(details, ec).time_since_epoch().count();
+                    if (ec) continue;
+
+                    std::string const path = path_to_string(directory);
+                    auto cached = state->lookup.find(path);
+                    if (cached != state->lookup.end()) {
+                        LevelView const level = state->index[cached->second];
+                        if (level.size == size && level.modified == modified) {
+                            present.push_back(path);
+                            continue;
+                        }
+                    }
+
+                    if (auto level = load_level(directory)) {
+                        present.push_back(path);
+                        results.emplace_back(std::move(*level));
+                    }
+                }
+
+                {
+                    std::lock_guard lock(state->mutex);
+                    state->pending.insert(state->pending.end(), std::make_move_iterator(results.begin()), std::make_move_iterator(results.end()));
+                    state->present.insert(state->present.end(), std::make_move_iterator(present.begin()), std::make_move_iterator(present.end()));
+                }
+
+                state->scanned.fetch_add(batch.size(), std::memory_order_acq_rel);
+                wake_main_thread();
+            });
+        }
+    });
+}
+
+void LevelLibrary::refresh(std::vector<std::filesystem::path> const& directories) {
+    for (size_t begin = 0; begin < directories.size(); begin += kScanBatch) {
+        size_t const end = std::min(begin + kScanBatch, directories.size());
+        std::vector<std::filesystem::path> batch(directories.begin() + begin, directories.begin() + end);
+
+        mRefresh->outstanding.fetch_add(1, std::memory_order_relaxed);
+        mPool.submit([state = mRefresh, batch = std::move(batch)]() {
+            TE_PROFILE_ZONE("Level Refresh Batch");
+
+            std::vector<RefreshState::Update> results;
+            results.reserve(batch.size());
+
+            for (auto const& directory : batch)
+                results.emplace_back(path_to_string(directory), load_level(directory));
+
+            {
+                std::lock_guard lock(state->mutex);
+                state->pending.insert(state->pending.end(), std::make_move_iterator(results.begin()), std::make_move_iterator(results.end()));
+            }
+
+            state->outstanding.fetch_sub(1, std::memory_order_acq_rel);
+            wake_main_thread();
+        });
+    }
+}
+
+bool LevelLibrary::poll() {
+    TE_PROFILE_ZONE("Level Library Poll");
+
+    bool changed = false;
+
+    if (mScan) {
+        bool const finished = mScan->finished();
+
+        std::vector<Level> pending;
+        {
+            std::lock_guard lock(mScan->mutex);
+            pending.swap(mScan->pending);
+        }
+
+        for (auto const& level : pending)
+            upsert(level);
+        changed |= !pending.empty();
+
+        if (finished) {
+            std::vector<std::string> present;
+            {
+                std::lock_guard lock(mScan->mutex);
+                present.swap(mScan->present);
+            }
+            std::sort(present.begin(), present.end());
+
+            // Back to front, `erase_at` moves the last level into the hole
+            for (size_t i = mLevels.size(); i-- > 0;) {
+                if (std::binary_search(present.begin(), present.end(), mLevels[i].path)) continue;
+                erase_at(i);
+                changed = true;
+            }
+
+            // Batches skip levels matching the snapshot, a refresh may have dropped one of them from the list since
+            build_lookup();
+            for (auto const& path : present) {
+                if (mLookup.contains(path)) continue;
+
+                auto cached = mScan->lookup.find(path);
+                if (cached == mScan->lookup.end()) continue;
+
+                LevelView const level = mScan->index[cached->second];
+                upsert(Level{
+                    .name = std::string(level.name),
+                    .difficulty = std::string(level.difficulty),
+                    .description = std::string(level.description),
+                    .author = std::string(level.author),
+                    .path = std::string(level.path),
+                    .modified = level.modified,
+                    .size = level.size,
+                });
+                changed = true;
+            }
+
+            mIndexDirty |= mScan->rewrite;
+            mScan.reset();
+        }
+    }
+
+    std::vector<RefreshState::Update> updates;
+    {
+        std::lock_guard lock(mRefresh->mutex);
+        updates.swap(mRefresh->pending);
+    }
+
+    for (auto const& [path, level] : updates) {
+        if (level) upsert(*level);
+        else erase(path);
+    }
+
+    changed |= !updates.empty();
+    if (changed) ++mGeneration;
+
+    // Saved once everything in flight has landed so a burst writes the snapshot once, and
+    // never while the previous save still runs so an older list cannot land last
+    if (mIndexDirty && !mIndexPath.empty() && !mScan && mRefresh->outstanding.load(std::memory_order_acquire) == 0 && !mSaving->load(std::memory_order_acquire)) {
+        mSaving->store(true, std::memory_order_relaxed);
+        mPool.submit([saving = mSaving, indexPath = mIndexPath, levels = mLevels]() {
+            TE_PROFILE_ZONE("Level Snapshot Save");
+
+            // Sorted here so the next launch can show the table without sorting it
+            std::vector<uint32_t> const order = sort_levels(levels, LevelColumn::Name);
+            levels.save(indexPath, order);
+
+            // Changes made meanwhile are saved by the next poll
+            saving->store(false, std::memory_order_release);
+            wake_main_thread();
+        });
+        mIndexDirty = false;
+    }
+
+    return changed;
+}
+
+void LevelLibrary::upsert(Level const& level) {
+    build_lookup();
+    mIndexDirty = true;
+
+    auto it = mLookup.find(level.path);
+    if (it != mLookup.end()) {
+        mLevels.assign(it->second, level);
+        return;
+    }
+
+    mLookup.emplace(level.path, mLevels.size());
+    mLevels.push_back(level);
+}
+
+void LevelLibrary::erase(std::string const& path) {
+    build_lookup();
+
+    auto it = mLookup.find(path);
+    if (it != mLookup.end()) erase_at(it->second);
+}
+
+void LevelLibrary::erase_at(size_t index) {
+    mIndexDirty = true;
+
+    // Only entries pointing at these two indices are touched, a damaged snapshot can repeat a path
+    if (mLookupBuilt) {
+        size_t const last = mLevels.size() - 1;
+
+        if (auto it = mLookup.find(std::string(mLevels[index].path)); it != mLookup.end() && it->second == index) mLookup.erase(it);
+        if (auto it = mLookup.find(std::string(mLevels[last].path)); index != last && it != mLookup.end() && it->second == last) it->second = index;
+    }
+
+    mLevels.swap_remove(index);
+}
+
+void LevelLibrary::build_lookup() {
+    if (mLookupBuilt) return;
+
+    mLookup.clear();
+    mLookup.reserve(mLevels.size());
+    for (size_t i = 0; i < mLevels.size(); ++i)
+        mLookup.emplace(mLevels[i].path, i);
+
+    mLookupBuilt = true;
+}
+
+bool LevelLibrary::scanning() const {
+    return mScan != nullptr;
+}
+
+size_t LevelLibrary::scanned() const {
+    return mScan ? mScan->scanned.load(std::memory_order_relaxed) : 0;
+}
+
+size_t LevelLibrary::total() const {
+    return mScan ? mScan->total.load(std::memory_order_relaxed) : 0;
+}
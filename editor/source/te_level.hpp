@@ -0,0 +1,90 @@
+#pragma once
+
+#include "te_level_list.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class ThreadPool;
+
+struct Level {
+    std::string name;
+    std::string difficulty;
+    std::string description;
+    std::string author;
+
+    // Level directory, also the key into the scan index
+    std::string path;
+
+    // `LEVEL DETAILS.txt` stamp the fields above were read from
+    int64_t modified = 0;
+    uint64_t size = 0;
+};
+
+// Parses `directory/LEVEL DETAILS.txt`, nullopt if it is missing or malformed
+std::optional<Level> load_level(std::filesystem::path const& directory);
+
+// Levels found under a root directory. The last saved snapshot is mapped on construction
+// so the list is there before any scan. Scans and refreshes run on the pool and only hand
+// back what changed, which `poll` merges on the main thread. A details file that kept its
+// mtime and size is never parsed again. With an empty `indexPath` no snapshot is read or
+// written and every level is parsed.
+class LevelLibrary final {
+public:
+    LevelLibrary(ThreadPool& pool, std::filesystem::path root, std::filesystem::path indexPath);
+    ~LevelLibrary() noexcept;
+
+    LevelLibrary(LevelLibrary const&) = delete;
+    LevelLibrary& operator=(LevelLibrary const&) = delete;
+
+    // Starts a full rescan, any scan already in flight is abandoned
+    void scan();
+
+    // Abandons a scan in flight, levels it already handed back stay and nothing is pruned
+    void cancel();
+
+    // Reloads just these level directories, ones that no longer load are removed
+    void refresh(std::vector<std::filesystem::path> const& directories);
+
+    // Moves finished entries into `levels`, returns true if the list changed
+    bool poll();
+
+    inline LevelList const& levels() const { return mLevels; }
+
+    // Bumped whenever `levels` changes
+    inline uint64_t generation() const { return mGeneration; }
+
+    bool scanning() const;
+    size_t scanned() const;
+    size_t total() const;
+private:
+    struct ScanState;
+    struct RefreshState;
+
+    void upsert(Level const& level);
+    void erase(std::string const& path);
+    void erase_at(size_t index);
+    // Built on first use so mapping a snapshot stays free of per level work
+    void build_lookup();
+
+    ThreadPool& mPool;
+    std::filesystem::path mRoot;
+    std::filesystem::path mIndexPath;
+
+    LevelList mLevels;
+    std::unordered_map<std::string, size_t> mLookup;
+    bool mLookupBuilt = false;
+    uint64_t mGeneration = 1;
+    bool mIndexDirty = false;
+
+    std::shared_ptr<ScanState> mScan;
+    std::shared_ptr<RefreshState> mRefresh;
+    // Set while a snapshot save runs on the pool, the next one waits for it
+    std::shared_ptr<std::atomic<bool>> mSaving;
+};
@@ -0,0 +1,332 @@
+#include "te_level_details.hpp"
+#include "te_level.hpp"
+#include "te_profiler.hpp"
+
+#include <yaml-cpp/yaml.h>
+
+#include <cctype>
+#include <string>
+
+namespace {
+    bool is_plain_char(char c) {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c == '-' || c == '.' || c == '+';
+    }
+
+    // Yaml reads these plain scalars as null, which yaml-cpp turns into the string "null"
+    bool is_null(std::string_view value) {
+        return value.empty() || value == "~" || value == "null" || value == "Null" || value == "NULL";
+    }
+
+    int hex_digit(char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+
+    void append_utf8(std::string& out, uint32_t codepoint) {
+        if (codepoint < 0x80) {
+            out += static_cast<char>(codepoint);
+        }
+        else if (codepoint < 0x800) {
+            out += static_cast<char>(0xC0 | (codepoint >> 6));
+            out += static_cast<char>(0x80 | (codepoint & 0x3F));
+        }
+        else {
+            out += static_cast<char>(0xE0 | (codepoint >> 12));
+            out += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (codepoint & 0x3F));
+        }
+    }
+
+    class DetailsParser final {
+    public:
+        DetailsParser(std::string_view text, Level& level) : mText(text), mEnd(text.size()), mLevel(level) {}
+
+        bool parse() {
+            if (mText.starts_with("\xEF\xBB\xBF")) mPos = 3;
+
+            size_t const start = mPos;
+            skip_space();
+            if (at('{')) return parse_object();
+
+            mPos = start;
+            return parse_block();
+        }
+    private:
+        // Null for keys the level does not keep, fails on a repeated key so yaml-cpp decides which one wins
+        bool target(std::string_view key, std::string*& out) {
+            static constexpr std::string_view kKeys[] = { "level_name", "difficulty", "description", "author" };
+            std::string* const fields[] = { &mLevel.name, &mLevel.difficulty, &mLevel.description, &mLevel.author };
+
+            out = nullptr;
+            for (size_t i = 0; i < std::size(kKeys); ++i) {
+                if (key != kKeys[i]) continue;
+                if (mSeen & (1u << i)) return false;
+
+                mSeen |= 1u << i;
+                out = fields[i];
+            }
+
+            return true;
+        }
+
+        // Tabs are left out on purpose, yaml only allows them in some of the places JSON does.
+        // A carriage return only counts as part of CRLF, yaml-cpp keeps a lone one in the text.
+        void skip_space() {
+            while (mPos < mEnd) {
+                char const c = mText[mPos];
+                if (c == '\r' && mPos + 1 < mEnd && mText[mPos + 1] == '\n') ++mPos;
+                else if (c != ' ' && c != '\n') break;
+                ++mPos;
+            }
+        }
+
+        bool at(char c) const {
+            return mPos < mEnd && mText[mPos] == c;
+        }
+
+        // A key without escapes, handed back as a view into the text
+        bool quoted_key(std::string_view& key) {
+            size_t const begin = ++mPos;
+            while (mPos < mEnd && mText[mPos] != '"') {
+                if (mText[mPos] == '\\' || static_cast<unsigned char>(mText[mPos]) < 0x20) return false;
+                ++mPos;
+            }
+
+            if (mPos == mEnd) return false;
+            key = mText.substr(begin, mPos++ - begin);
+            return true;
+        }
+
+        // JSON escapes only. Line breaks fold in yaml and are left to yaml-cpp, `out` may be null to just validate
+        bool double_quoted(std::string* out) {
+            ++mPos;
+            while (mPos < mEnd) {
+                char const c = mText[mPos++];
+                if (c == '"') return true;
+                if (static_cast<unsigned char>(c) < 0x20 && c != '\t') return false;
+
+                if (c != '\\') {
+                    if (out) *out += c;
+                    continue;
+                }
+
+                if (mPos == mEnd) return false;
+                char const escape = mText[mPos++];
+                char decoded;
+                switch (escape) {
+                case '"': decoded = '"'; break;
+                case '\\': decoded = '\\'; break;
+                case '/': decoded = '/'; break;
+                case 'b': decoded = '\b'; break;
+                case 'f': decoded = '\f'; break;
+                case 'n': decoded = '\n'; break;
+                case 'r': decoded = '\r'; break;
+                case 't': decoded = '\t'; break;
+                case 'u': {
+                    if (mEnd - mPos < 4) return false;
+
+                    uint32_t codepoint = 0;
+                    for (int i = 0; i < 4; ++i) {
+                        int const digit = hex_digit(mText[mPos++]);
+                        if (digit < 0) return false;
+                        codepoint = codepoint << 4 | static_cast<uint32_t>(digit);
+                    }
+
+                    // Surrogate pairs and the nul character differ between parsers
+                    if (codepoint == 0 || (codepoint >= 0xD800 && codepoint <= 0xDFFF)) return false;
+                    if (out) append_utf8(*out, codepoint);
+                    continue;
+                }
+                default:
+                    return false;
+                }
+
+                if (out) *out += decoded;
+            }
+
+            return false;
+        }
+
+        bool single_quoted(std::string* out) {
+            ++mPos;
+            while (mPos < mEnd) {
+                char const c = mText[mPos++];
+                if (c == '\'') {
+                    if (!at('\'')) return true;
+                    ++mPos;
+                }
+                else if (static_cast<unsigned char>(c) < 0x20 && c != '\t') {
+                    return false;
+                }
+
+                if (out) *out += c;
+            }
+
+            return false;
+        }
+
+        static void assign_plain(std::string_view value, std::string* out) {
+            if (!out) return;
+
+            if (is_null(value)) *out = "null";
+            else *out = value;
+        }
+
+        // {"key": value, ...}, values have to be strings or bare words such as numbers
+        bool parse_object() {
+            ++mPos;
+            skip_space();
+            if (at('}')) return finish_object();
+
+            while (true) {
+                std::string_view key;
+                std::string* out;
+                if (!at('"') || !quoted_key(key) || !target(key, out)) return false;
+
+                // Implicit keys end on their own line
+                while (at(' ')) ++mPos;
+                if (!at(':')) return false;
+                ++mPos;
+                skip_space();
+
+                if (at('"')) {
+                    if (!double_quoted(out)) return false;
+                }
+                else {
+                    size_t const begin = mPos;
+                    while (mPos < mEnd && is_plain_char(mText[mPos])) ++mPos;
+
+                    // A lone sign or dot is an indicator rather than a scalar
+                    if (mPos == begin || (!std::isalnum(static_cast<unsigned char>(mText[begin])) && (mPos - begin < 2 || !std::isalnum(static_cast<unsigned char>(mText[begin + 1]))))) return false;
+                    assign_plain(mText.substr(begin, mPos - begin), out);
+                }
+
+                skip_space();
+                if (at('}')) return finish_object();
+                if (!at(',')) return false;
+
+                ++mPos;
+                skip_space();
+            }
+        }
+
+        bool finish_object() {
+            ++mPos;
+            skip_space();
+            return mPos == mEnd;
+        }
+
+        // One `key: value` per line at column zero, no nesting, anchors, tags or multi-line scalars
+        bool parse_block() {
+            while (mPos < mText.size()) {
+                size_t next = mText.find('\n', mPos);
+                next = next == std::string_view::npos ? mText.size() : next + 1;
+
+                mEnd = next;
+                if (mEnd > mPos && mText[mEnd - 1] == '\n') {
+                    --mEnd;
+                    if (mEnd > mPos && mText[mEnd - 1] == '\r') --mEnd;
+                }
+
+                if (!parse_line()) return false;
+                mPos = next;
+            }
+
+            return true;
+        }
+
+        bool parse_line() {
+            std::string_view const line = mText.substr(mPos, mEnd - mPos);
+            if (line.find_first_not_of(' ') == std::string_view::npos || line.front() == '#') return true;
+
+            std::string_view key;
+            if (at('"')) {
+                if (!quoted_key(key)) return false;
+            }
+            else {
+                if (!std::isalnum(static_cast<unsigned char>(line.front())) && line.front() != '_') return false;
+
+                size_t const begin = mPos;
+                while (mPos < mEnd && is_plain_char(mText[mPos])) ++mPos;
+                key = mText.substr(begin, mPos - begin);
+            }
+
+            std::string* out;
+            if (!at(':') || !target(key, out)) return false;
+
+            ++mPos;
+            if (mPos < mEnd && mText[mPos] != ' ') return false;
+            while (at(' ')) ++mPos;
+
+            bool quoted = false;
+            if (at('"')) {
+                if (!double_quoted(out)) return false;
+                quoted = true;
+            }
+            else if (at('\'')) {
+                if (!single_quoted(out)) return false;
+                quoted = true;
+            }
+
+            std::string_view rest = mText.substr(mPos, mEnd - mPos);
+
+            // A comment needs whitespace in front of it
+            if (quoted && rest.starts_with('#')) return false;
+            if (size_t const comment = rest.find(" #"); comment != std::string_view::npos) rest = rest.substr(0, comment);
+            while (!rest.empty() && rest.back() == ' ') rest.remove_suffix(1);
+
+            if (quoted) return rest.empty();
+
+            // Indicators, tabs and control characters all need the real parser
+            static constexpr std::string_view kIndicators = "[]{}#&*!|>%@`'\",?:-";
+            if (!rest.empty() && kIndicators.find(rest.front()) != std::string_view::npos) return false;
+            for (char c : rest) {
+                if (static_cast<unsigned char>(c) < 0x20 || c == '\x7F') return false;
+            }
+            if (rest.find(": ") != std::string_view::npos || rest.ends_with(':')) return false;
+
+            assign_plain(rest, out);
+            return true;
+        }
+
+        std::string_view mText;
+        size_t mPos = 0;
+        // End of the part being parsed, the current line in block mode
+        size_t mEnd;
+        Level& mLevel;
+        // Bit per target key already assigned
+        unsigned int mSeen = 0;
+    };
+}
+
+bool parse_level_details(std::string_view text, Level& level) {
+    return parse_level_details_fast(text, level) || parse_level_details_yaml(text, level);
+}
+
+bool parse_level_details_fast(std::string_view text, Level& level) {
+    level.name.clear();
+    level.difficulty.clear();
+    level.description.clear();
+    level.author.clear();
+
+    return DetailsParser(text, level).parse();
+}
+
+bool parse_level_details_yaml(std::string_view text, Level& level) {
+    TE_PROFILE_ZONE("Level Details Yaml");
+
+    try {
+        YAML::Node node = YAML::Load(std::string(text));
+
+        level.name = node["level_name"].as<std::string>("");
+        level.difficulty = node["difficulty"].as<std::string>("");
+        level.description = node["description"].as<std::string>("");
+        level.author = node["author"].as<std::string>("");
+        return true;
+    }
+    catch (YAML::Exception const&) {
+        return false;
+    }
+}
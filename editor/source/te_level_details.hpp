@@ -0,0 +1,18 @@
+#pragma once
+
+#include <string_view>
+
+struct Level;
+
+// `LEVEL DETAILS.txt` only ever needs four scalars. The fast path reads them in one pass
+// straight out of the text, covering the JSON objects the level editor writes and flat
+// `key: value` yaml. Anything outside that subset is left to yaml-cpp so both agree.
+
+// Fills the details fields of `level`, false if the text is malformed
+bool parse_level_details(std::string_view text, Level& level);
+
+// False when the text uses yaml the fast path does not handle, `level` is then unspecified
+bool parse_level_details_fast(std::string_view text, Level& level);
+
+// Full yaml-cpp parse, false if the text is malformed
+bool parse_level_details_yaml(std::string_view text, Level& level);
@@ -0,0 +1,271 @@
+#include "te_level_list.hpp"
+#include "te_level.hpp"
+#include "te_util.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+static_assert(std::endian::native == std::endian::little, "level snapshots are read in place");
+
+namespace {
+    constexpr char kSnapshotMagic[4] = { 'T', 'E', 'L', 'S' };
+    constexpr uint32_t kSnapshotVersion = 1;
+
+    // Below this much garbage the arena is never compacted
+    constexpr size_t kCompactThreshold = 64 * 1024;
+
+    struct Header {
+        char magic[4];
+        uint32_t version;
+        uint32_t count;
+        // Either zero or `count`
+        uint32_t orderCount;
+        uint64_t arenaSize;
+        // Over everything after the header
+        uint64_t checksum;
+    };
+
+    static_assert(sizeof(Header) == 32);
+
+    constexpr std::string_view kEmpty = "";
+}
+
+LevelList::LevelList(LevelList const& other) {
+    *this = other;
+}
+
+LevelList& LevelList::operator=(LevelList const& other) {
+    if (this == &other) return *this;
+
+    mFile.close();
+    mOwnedRecords.assign(other.mRecords.begin(), other.mRecords.end());
+    mOwnedArena.assign(other.mArena.begin(), other.mArena.end());
+    mOwnedNameOrder.assign(other.mNameOrder.begin(), other.mNameOrder.end());
+    mGarbage = other.mGarbage;
+
+    mRecords = mOwnedRecords;
+    mArena = mOwnedArena;
+    mNameOrder = mOwnedNameOrder;
+    return *this;
+}
+
+LevelList::LevelList(LevelList&& other) noexcept {
+    *this = std::move(other);
+}
+
+LevelList& LevelList::operator=(LevelList&& other) noexcept {
+    // Vector buffers and the mapping keep their addresses, so the spans can simply trade places
+    std::swap(mRecords, other.mRecords);
+    std::swap(mArena, other.mArena);
+    std::swap(mNameOrder, other.mNameOrder);
+    std::swap(mOwnedRecords, other.mOwnedRecords);
+    std::swap(mOwnedArena, other.mOwnedArena);
+    std::swap(mOwnedNameOrder, other.mOwnedNameOrder);
+    std::swap(mGarbage, other.mGarbage);
+    std::swap(mFile, other.mFile);
+    return *this;
+}
+
+LevelView LevelList::operator[](size_t index) const {
+    Record const& record = mRecords[index];
+
+    auto const field = [&](size_t i) {
+        uint64_t const end = static_cast<uint64_t>(record.offsets[i]) + record.lengths[i];
+
+        // An unverified mapping may point anywhere, such fields read as empty
+        if (end >= mArena.size() || mArena[end] != '\0') return kEmpty;
+        return std::string_view(mArena.data() + record.offsets[i], record.lengths[i]);
+    };
+
+    return LevelView{
+        .path = field(0),
+        .name = field(1),
+        .difficulty = field(2),
+        .description = field(3),
+        .author = field(4),
+        .modified = record.modified,
+        .size = record.size,
+    };
+}
+
+void LevelList::push_back(Level const& level) {
+    own();
+
+    Record record;
+    append(level, record);
+    mOwnedRecords.push_back(record);
+    mRecords = mOwnedRecords;
+}
+
+void LevelList::assign(size_t index, Level const& level) {
+    own();
+
+    Record& record = mOwnedRecords[index];
+    for (uint32_t length : record.lengths)
+        mGarbage += length + 1;
+
+    append(level, record);
+    compact();
+}
+
+void LevelList::swap_remove(size_t index) {
+    own();
+
+    for (uint32_t length : mOwnedRecords[index].lengths)
+        mGarbage += length + 1;
+
+    mOwnedRecords[index] = mOwnedRecords.back();
+    mOwnedRecords.pop_back();
+    mRecords = mOwnedRecords;
+    compact();
+}
+
+void LevelList::clear() {
+    mFile.close();
+    mOwnedRecords.clear();
+    mOwnedArena.clear();
+    mOwnedNameOrder.clear();
+    mGarbage = 0;
+
+    mRecords = {};
+    mArena = {};
+    mNameOrder = {};
+}
+
+void LevelList::own() {
+    if (mFile.is_open()) {
+        mOwnedRecords.assign(mRecords.begin(), mRecords.end());
+        mOwnedArena.assign(mArena.begin(), mArena.end());
+        mFile.close();
+
+        mRecords = mOwnedRecords;
+        mArena = mOwnedArena;
+    }
+
+    // Any change invalidates the saved order
+    mOwnedNameOrder.clear();
+    mNameOrder = {};
+}
+
+void LevelList::append(Level const& level, Record& record) {
+    std::string const* const fields[] = { &level.path, &level.name, &level.difficulty, &level.description, &level.author };
+
+    for (size_t i = 0; i < std::size(fields); ++i) {
+        record.offsets[i] = static_cast<uint32_t>(mOwnedArena.size());
+        record.lengths[i] = static_cast<uint32_t>(fields[i]->size());
+        mOwnedArena.insert(mOwnedArena.end(), fields[i]->begin(), fields[i]->end());
+        mOwnedArena.push_back('\0');
+    }
+
+    record.modified = level.modified;
+    record.size = level.size;
+    mArena = mOwnedArena;
+}
+
+void LevelList::compact() {
+    if (mGarbage < kCompactThreshold || mGarbage < mOwnedArena.size() / 2) return;
+
+    mOwnedArena = pack(mOwnedRecords);
+    mGarbage = 0;
+    mRecords = mOwnedRecords;
+    mArena = mOwnedArena;
+}
+
+std::vector<char> LevelList::pack(std::vector<Record>& records) const {
+    std::vector<char> arena;
+    arena.reserve(mArena.size() - std::min(mGarbage, mArena.size()));
+
+    // Read through the bounds checked views, a record copied out of an unverified mapping can point anywhere
+    for (size_t index = 0; index < records.size(); ++index) {
+        LevelView const level = (*this)[index];
+        std::string_view const fields[] = { level.path, level.name, level.difficulty, level.description, level.author };
+
+        Record& record = records[index];
+        for (size_t i = 0; i < std::size(fields); ++i) {
+            record.offsets[i] = static_cast<uint32_t>(arena.size());
+            record.lengths[i] = static_cast<uint32_t>(fields[i].size());
+            arena.insert(arena.end(), fields[i].begin(), fields[i].end());
+            arena.push_back('\0');
+        }
+    }
+
+    return arena;
+}
+
+bool LevelList::map(std::filesystem::path const& path, bool verify) {
+    MappedFile file;
+    if (!file.open(path)) return false;
+
+    auto const bytes = file.bytes();
+    if (bytes.size() < sizeof(Header)) return false;
+
+    Header header;
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    if (std::memcmp(header.magic, kSnapshotMagic, sizeof(header.magic)) != 0 || header.version != kSnapshotVersion) return false;
+    if (header.orderCount != 0 && header.orderCount != header.count) return false;
+
+    uint64_t const recordBytes = static_cast<uint64_t>(header.count) * sizeof(Record);
+    uint64_t const orderBytes = static_cast<uint64_t>(header.orderCount) * sizeof(uint32_t);
+    if (bytes.size() != sizeof(Header) + recordBytes + orderBytes + header.arenaSize) return false;
+
+    std::byte const* data = bytes.data() + sizeof(Header);
+    std::span<Record const> records(reinterpret_cast<Record const*>(data), header.count);
+    std::span<uint32_t const> order(reinterpret_cast<uint32_t const*>(data + recordBytes), header.orderCount);
+    std::span<char const> arena(reinterpret_cast<char const*>(data + recordBytes + orderBytes), static_cast<size_t>(header.arenaSize));
+
+    // The table indexes rows through the order, so it is checked even without `verify`
+    for (uint32_t index : order)
+        if (index >= header.count) return false;
+
+    if (verify) {
+        uint64_t hash = 0;
+        hash = checksum(records.data(), records.size_bytes(), hash);
+        hash = checksum(order.data(), order.size_bytes(), hash);
+        hash = checksum(arena.data(), arena.size(), hash);
+        if (hash != header.checksum) return false;
+
+        for (Record const& record : records) {
+            for (size_t i = 0; i < std::size(record.offsets); ++i) {
+                uint64_t const end = static_cast<uint64_t>(record.offsets[i]) + record.lengths[i];
+                if (end >= arena.size() || arena[end] != '\0') return false;
+            }
+        }
+    }
+
+    clear();
+    mFile = std::move(file);
+    mRecords = records;
+    mArena = arena;
+    mNameOrder = order;
+    return true;
+}
+
+bool LevelList::save(std::filesystem::path const& path, std::span<uint32_t const> nameOrder) const {
+    if (!nameOrder.empty() && nameOrder.size() != mRecords.size()) nameOrder = {};
+
+    // Garbage is left out, every record gets its strings rewritten back to back
+    std::vector<Record> records(mRecords.begin(), mRecords.end());
+    std::vector<char> const arena = pack(records);
+
+    Header header;
+    std::memcpy(header.magic, kSnapshotMagic, sizeof(header.magic));
+    header.version = kSnapshotVersion;
+    header.count = static_cast<uint32_t>(records.size());
+    header.orderCount = static_cast<uint32_t>(nameOrder.size());
+    header.arenaSize = arena.size();
+
+    uint64_t hash = 0;
+    hash = checksum(records.data(), records.size() * sizeof(Record), hash);
+    hash = checksum(nameOrder.data(), nameOrder.size_bytes(), hash);
+    hash = checksum(arena.data(), arena.size(), hash);
+    header.checksum = hash;
+
+    return write_file_atomic(path, [&](std::ostream& file) {
+        file.write(reinterpret_cast<char const*>(&header), sizeof(header));
+        file.write(reinterpret_cast<char const*>(records.data()), static_cast<std::streamsize>(records.size() * sizeof(Record)));
+        file.write(reinterpret_cast<char const*>(nameOrder.data()), static_cast<std::streamsize>(nameOrder.size_bytes()));
+        file.write(arena.data(), static_cast<std::streamsize>(arena.size()));
+        return true;
+    });
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "te_mapped_file.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct Level;
+
+// One level's fields as views into a `LevelList`, each one is followed by a nul so
+// `data()` can go straight to C apis. Valid until the list next changes.
+struct LevelView {
+    std::string_view path;
+    std::string_view name;
+    std::string_view difficulty;
+    std::string_view description;
+    std::string_view author;
+
+    int64_t modified = 0;
+    uint64_t size = 0;
+};
+
+// Every level's strings packed into one arena next to fixed size records. The same layout
+// is the on-disk snapshot, so a saved list is mapped and read in place without parsing.
+// A mapped list is copied into memory the first time it changes.
+class LevelList final {
+public:
+    LevelList() = default;
+
+    LevelList(LevelList const& other);
+    LevelList& operator=(LevelList const& other);
+    LevelList(LevelList&& other) noexcept;
+    LevelList& operator=(LevelList&& other) noexcept;
+
+    inline size_t size() const { return mRecords.size(); }
+    inline bool empty() const { return mRecords.empty(); }
+    LevelView operator[](size_t index) const;
+
+    void push_back(Level const& level);
+    void assign(size_t index, Level const& level);
+    // Moves the last level into `index`
+    void swap_remove(size_t index);
+    void clear();
+
+    // Level indices sorted by name as the snapshot was saved with, empty once the list changed
+    inline std::span<uint32_t const> name_order() const { return mNameOrder; }
+
+    // Only checks the header, records are bounds checked as they are read. `verify` also
+    // checks every record and the checksum, which costs a pass over the whole file.
+    bool map(std::filesystem::path const& path, bool verify);
+    inline bool mapped() const { return mFile.is_open(); }
+
+    // `nameOrder` is stored for `name_order`, it has to be empty or hold every index
+    bool save(std::filesystem::path const& path, std::span<uint32_t const> nameOrder) const;
+private:
+    // Little endian on disk, the strings of a level are stored in field order
+    struct Record {
+        uint32_t offsets[5];
+        uint32_t lengths[5];
+        int64_t modified;
+        uint64_t size;
+    };
+
+    static_assert(sizeof(Record) == 56);
+
+    void own();
+    void append(Level const& level, Record& record);
+    void compact();
+    // Arena holding just the strings `records` point at, their offsets are rewritten to match
+    std::vector<char> pack(std::vector<Record>& records) const;
+
+    // Point into `mFile` while mapped, otherwise into the vectors below
+    std::span<Record const> mRecords;
+    std::span<char const> mArena;
+    std::span<uint32_t const> mNameOrder;
+
+    std::vector<Record> mOwnedRecords;
+    std::vector<char> mOwnedArena;
+    std::vector<uint32_t> mOwnedNameOrder;
+    // Arena bytes no record points at anymore
+    size_t mGarbage = 0;
+
+    MappedFile mFile;
+};
@@ -0,0 +1,673 @@
+#include "te_level_pack.hpp"
+#include "te_hash.hpp"
+#include "te_level.hpp"
+#include "te_profiler.hpp"
+#include "te_thread_pool.hpp"
+#include "te_util.hpp"
+#include "te_waveform.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <unordered_set>
+
+static_assert(std::endian::native == std::endian::little, "level packs are read in place");
+
+namespace {
+    constexpr char kPackMagic[4] = { 'T', 'E', 'L', 'P' };
+    constexpr uint32_t kPackVersion = 1;
+
+    // Payloads start on this boundary, enough for anything read straight out of the mapping
+    constexpr uint64_t kAlignment = 16;
+
+    // Smaller files are always stored, larger ones only keep compression that saves an eighth
+    constexpr size_t kMinCompressSize = 64;
+
+    constexpr uint32_t kStored = 0;
+    constexpr uint32_t kLz = 1;
+
+    constexpr size_t kLzMinMatch = 4;
+    constexpr size_t kLzMaxOffset = 65535;
+    constexpr int kLzHashBits = 14;
+    // A length byte of 255 stands for 255 more output bytes, no part of the stream expands further
+    constexpr uint64_t kLzMaxExpansion = 255;
+
+    using Clock = std::chrono::steady_clock;
+
+    struct Header {
+        char magic[4];
+        uint32_t version;
+        uint32_t levelCount;
+        uint32_t entryCount;
+        // Power of two with at least half the slots empty
+        uint32_t slotCount;
+        uint32_t reserved;
+        uint64_t stringsSize;
+        // Over the slots, entries, levels and strings
+        uint64_t checksum;
+        // First payload, everything before it is the table of contents
+        uint64_t dataOffset;
+    };
+
+    static_assert(sizeof(Header) == 48);
+
+    constexpr uint64_t align(uint64_t value) {
+        return (value + kAlignment - 1) & ~(kAlignment - 1);
+    }
+
+    // Names come out of the pack, anything that could climb out of the destination is refused
+    bool safe_relative(std::string_view name) {
+        if (name.empty()) return false;
+
+        size_t begin = 0;
+        while (begin <= name.size()) {
+            size_t end = name.find('/', begin);
+            if (end == std::string_view::npos) end = name.size();
+
+            std::string_view const part = name.substr(begin, end - begin);
+            if (part.empty() || part == "." || part == "..") return false;
+            if (part.find_first_of("\\:") != std::string_view::npos) return false;
+
+            begin = end + 1;
+        }
+
+        return true;
+    }
+
+    std::filesystem::path utf8_path(std::string_view text) {
+        return std::filesystem::path(std::u8string(reinterpret_cast<char8_t const*>(text.data()), text.size()));
+    }
+}
+
+bool LevelPack::open(std::filesystem::path const& path) {
+    TE_PROFILE_ZONE("Open Level Pack");
+
+    close();
+
+    MappedFile file;
+    if (!file.open(path)) return false;
+
+    auto const bytes = file.bytes();
+    if (bytes.size() < sizeof(Header)) return false;
+
+    Header header;
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    if (std::memcmp(header.magic, kPackMagic, sizeof(header.magic)) != 0 || header.version != kPackVersion) return false;
+
+    // Probing relies on an empty slot always being found
+    if (!std::has_single_bit(header.slotCount) || header.slotCount < static_cast<uint64_t>(header.entryCount) * 2) return false;
+    if (header.stringsSize > bytes.size()) return false;
+
+    uint64_t const slotBytes = static_cast<uint64_t>(header.slotCount) * sizeof(Slot);
+    uint64_t const entryBytes = static_cast<uint64_t>(header.entryCount) * sizeof(EntryRecord);
+    uint64_t const levelBytes = static_cast<uint64_t>(header.levelCount) * sizeof(LevelRecord);
+    uint64_t const tocEnd = sizeof(Header) + slotBytes + entryBytes + levelBytes + header.stringsSize;
+    if (tocEnd > header.dataOffset || header.dataOffset > bytes.size()) return false;
+
+    std::byte const* data = bytes.data() + sizeof(Header);
+    std::span<Slot const> slots(reinterpret_cast<Slot const*>(data), header.slotCount);
+    std::span<EntryRecord const> entries(reinterpret_cast<EntryRecord const*>(data + slotBytes), header.entryCount);
+    std::span<LevelRecord const> levels(reinterpret_cast<LevelRecord const*>(data + slotBytes + entryBytes), header.levelCount);
+    std::span<char const> strings(reinterpret_cast<char const*>(data + slotBytes + entryBytes + levelBytes), static_cast<size_t>(header.stringsSize));
+
+    // The table of contents is small next to the payloads, so unlike the level snapshot it is always checked in full
+    uint64_t hash = 0;
+    hash = checksum(slots.data(), slots.size_bytes(), hash);
+    hash = checksum(entries.data(), entries.size_bytes(), hash);
+    hash = checksum(levels.data(), levels.size_bytes(), hash);
+    hash = checksum(strings.data(), strings.size(), hash);
+    if (hash != header.checksum) return false;
+
+    auto const valid_string = [&](uint32_t offset, uint32_t length) {
+        uint64_t const end = static_cast<uint64_t>(offset) + length;
+        return end < strings.size() && strings[end] == '\0';
+    };
+
+    // `find` stops at the first empty slot, a table without enough of them would never end a probe
+    size_t used = 0;
+    for (Slot const& slot : slots) {
+        if (slot.entry > entries.size()) return false;
+        if (slot.entry != 0) ++used;
+    }
+    if (used > slots.size() / 2) return false;
+
+    for (EntryRecord const& entry : entries) {
+        if (!valid_string(entry.nameOffset, entry.nameLength) || entry.level >= levels.size()) return false;
+        if (entry.offset < header.dataOffset || entry.offset > bytes.size() || entry.storedSize > bytes.size() - entry.offset) return false;
+        if (entry.compression == kStored ? entry.storedSize != entry.size : entry.compression != kLz) return false;
+        // Packs come from anywhere, a size the payload cannot decode to would only make `read` allocate it
+        if (entry.compression == kLz && entry.size > entry.storedSize * kLzMaxExpansion) return false;
+    }
+
+    for (size_t index = 0; index < levels.size(); ++index) {
+        LevelRecord const& level = levels[index];
+        for (size_t i = 0; i < std::size(level.offsets); ++i)
+            if (!valid_string(level.offsets[i], level.lengths[i])) return false;
+
+        if (static_cast<uint64_t>(level.firstEntry) + level.entryCount > entries.size()) return false;
+        for (size_t i = level.firstEntry; i < level.firstEntry + level.entryCount; ++i)
+            if (entries[i].level != index) return false;
+    }
+
+    mFile = std::move(file);
+    mSlots = slots;
+    mEntries = entries;
+    mLevels = levels;
+    mStrings = strings;
+    return true;
+}
+
+void LevelPack::close() {
+    mFile.close();
+    mSlots = {};
+    mEntries = {};
+    mLevels = {};
+    mStrings = {};
+}
+
+std::string_view LevelPack::string(uint32_t offset, uint32_t length) const {
+    return std::string_view(mStrings.data() + offset, length);
+}
+
+LevelView LevelPack::level(size_t index) const {
+    LevelRecord const& record = mLevels[index];
+
+    return LevelView{
+        .path = string(record.offsets[0], record.lengths[0]),
+        .name = string(record.offsets[1], record.lengths[1]),
+        .difficulty = string(record.offsets[2], record.lengths[2]),
+        .description = string(record.offsets[3], record.lengths[3]),
+        .author = string(record.offsets[4], record.lengths[4]),
+        .modified = record.modified,
+        .size = record.size,
+    };
+}
+
+std::pair<size_t, size_t> LevelPack::level_entries(size_t index) const {
+    LevelRecord const& record = mLevels[index];
+    return { record.firstEntry, static_cast<size_t>(record.firstEntry) + record.entryCount };
+}
+
+LevelPack::Entry LevelPack::entry(size_t index) const {
+    EntryRecord const& record = mEntries[index];
+
+    return Entry{
+        .name = string(record.nameOffset, record.nameLength),
+        .level = record.level,
+        .size = record.size,
+        .storedSize = record.storedSize,
+        .compressed = record.compression == kLz,
+    };
+}
+
+std::optional<size_t> LevelPack::find(std::string_view name) const {
+    if (mSlots.empty()) return std::nullopt;
+
+    uint32_t const hash = hash32(name);
+    size_t const mask = mSlots.size() - 1;
+
+    // hash32 output is already well mixed, its low bits pick the slot directly
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        Slot const& slot = mSlots[i];
+        if (slot.entry == 0) return std::nullopt;
+
+        EntryRecord const& record = mEntries[slot.entry - 1];
+        if (slot.hash == hash && string(record.nameOffset, record.nameLength) == name) return slot.entry - 1;
+    }
+}
+
+bool LevelPack::read(size_t index, std::vector<std::byte>& out) const {
+    EntryRecord const& record = mEntries[index];
+    auto const stored = mFile.bytes().subspan(static_cast<size_t>(record.offset), static_cast<size_t>(record.storedSize));
+
+    out.resize(static_cast<size_t>(record.size));
+    if (record.compression == kLz) {
+        if (!lz_decompress(stored, out)) return false;
+    }
+    else if (!stored.empty()) {
+        std::memcpy(out.data(), stored.data(), stored.size());
+    }
+
+    return checksum(out.data(), out.size(), 0) == record.checksum;
+}
+
+bool LevelPack::extract(std::filesystem::path const& root, LevelPackReport& report, std::atomic<bool> const* cancelled) const {
+    TE_PROFILE_ZONE("Extract Level Pack");
+    auto const start = Clock::now();
+
+    auto const stopped = [cancelled]() { return cancelled && cancelled->load(std::memory_order_relaxed); };
+
+    std::vector<std::byte> contents;
+    std::error_code ec;
+
+    for (size_t index = 0; index < mLevels.size() && !stopped(); ++index) {
+        std::string_view const directory = level(index).path;
+        if (!safe_relative(directory) || directory.find('/') != std::string_view::npos) {
+            report.errors.push_back(std::string(directory) + ": not a plain directory name");
+            continue;
+        }
+
+        // Unpacked aside and swapped in whole, a damaged entry leaves the existing level alone
+        std::filesystem::path const target = root / utf8_path(directory);
+        std::filesystem::path staging = target;
+        staging += ".te-import";
+        std::filesystem::remove_all(staging, ec);
+
+        bool ok = true;
+        auto const [first, last] = level_entries(index);
+
+        for (size_t i = first; i < last && ok; ++i) {
+            if (stopped()) {
+                ok = false;
+                break;
+            }
+
+            Entry const file = entry(i);
+            std::string_view const relative = file.name.substr(std::min(directory.size() + 1, file.name.size()));
+
+            if (!file.name.starts_with(directory) || file.name.size() <= directory.size() || file.name[directory.size()] != '/' || !safe_relative(relative)) {
+                report.errors.push_back(std::string(file.name) + ": not inside its level");
+                ok = false;
+                break;
+            }
+
+            if (!read(i, contents)) {
+                report.errors.push_back(std::string(file.name) + ": damaged");
+                ok = false;
+                break;
+            }
+
+            std::filesystem::path const destination = staging / utf8_path(relative);
+            std::filesystem::create_directories(destination.parent_path(), ec);
+
+            std::ofstream stream(destination, std::ios::out | std::ios::binary);
+            stream.write(reinterpret_cast<char const*>(contents.data()), static_cast<std::streamsize>(contents.size()));
+            if (!stream) {
+                report.errors.push_back(path_to_string(destination) + ": could not be written");
+                ok = false;
+                break;
+            }
+
+            ++report.files;
+            report.bytes += file.size;
+            report.storedBytes += file.storedSize;
+        }
+
+        if (ok) {
+            // The old level is moved aside rather than deleted, a swap that fails puts it back
+            std::filesystem::path backup = target;
+            backup += ".te-backup";
+
+            // A backup without its level is all that is left of an import interrupted mid swap
+            if (!std::filesystem::exists(target, ec) && std::filesystem::exists(backup, ec)) std::filesystem::rename(backup, target, ec);
+            else std::filesystem::remove_all(backup, ec);
+
+            bool const existed = std::filesystem::exists(target, ec);
+            ec.clear();
+            if (existed) std::filesystem::rename(target, backup, ec);
+            if (!ec) std::filesystem::rename(staging, target, ec);
+
+            if (ec) {
+                report.errors.push_back(path_to_string(target) + ": " + ec.message());
+
+                std::error_code restore;
+                if (existed && !std::filesystem::exists(target, restore)) std::filesystem::rename(backup, target, restore);
+                if (restore) report.errors.push_back(path_to_string(backup) + ": the old level is left here, " + restore.message());
+            }
+            else {
+                std::error_code removed;
+                std::filesystem::remove_all(backup, removed);
+                ++report.levels;
+            }
+        }
+
+        if (!ok || ec) std::filesystem::remove_all(staging, ec);
+    }
+
+    if (stopped()) report.errors.push_back("cancelled, the remaining levels were not unpacked");
+
+    report.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return report.errors.empty();
+}
+
+bool LevelPack::write(std::filesystem::path const& path, std::span<std::filesystem::path const> directories, bool compress, LevelPackReport& report, std::atomic<bool> const* cancelled) {
+    TE_PROFILE_ZONE("Write Level Pack");
+    auto const start = Clock::now();
+
+    auto const stopped = [cancelled]() { return cancelled && cancelled->load(std::memory_order_relaxed); };
+
+    std::vector<LevelRecord> levels;
+    std::vector<EntryRecord> entries;
+    std::vector<char> strings;
+    std::vector<std::filesystem::path> sources;
+    std::unordered_set<std::string> packed;
+
+    auto const append = [&](std::string_view text, uint32_t& offset, uint32_t& length) {
+        offset = static_cast<uint32_t>(strings.size());
+        length = static_cast<uint32_t>(text.size());
+        strings.insert(strings.end(), text.begin(), text.end());
+        strings.push_back('\0');
+    };
+
+    for (auto const& directory : directories) {
+        if (stopped()) break;
+
+        std::string const name = path_to_string(directory.filename());
+
+        std::optional<Level> const level = load_level(directory);
+        if (!level) {
+            report.errors.push_back(name + ": no valid LEVEL DETAILS.txt");
+            continue;
+        }
+
+        if (!packed.insert(name).second) {
+            report.errors.push_back(name + ": more than one level with this name");
+            continue;
+        }
+
+        std::vector<std::filesystem::path> files;
+        std::error_code ec;
+        for (auto it = std::filesystem::recursive_directory_iterator(directory, ec); !ec && it != std::filesystem::recursive_directory_iterator(); it.increment(ec)) {
+            if (it->is_regular_file(ec) && !is_peak_cache(it->path())) files.emplace_back(it->path());
+        }
+        std::sort(files.begin(), files.end());
+
+        LevelRecord record{};
+        std::string_view const fields[] = { name, level->name, level->difficulty, level->description, level->author };
+        for (size_t i = 0; i < std::size(fields); ++i)
+            append(fields[i], record.offsets[i], record.lengths[i]);
+
+        record.firstEntry = static_cast<uint32_t>(entries.size());
+        record.entryCount = static_cast<uint32_t>(files.size());
+        record.modified = level->modified;
+        record.size = level->size;
+
+        for (auto const& file : files) {
+            std::string const entryName = name + "/" + path_to_string(file.lexically_relative(directory));
+
+            EntryRecord entry{};
+            entry.nameHash = hash32(entryName);
+            entry.level = static_cast<uint32_t>(levels.size());
+            append(entryName, entry.nameOffset, entry.nameLength);
+
+            entries.push_back(entry);
+            sources.push_back(file);
+        }
+
+        levels.push_back(record);
+    }
+
+    Header header{};
+    std::memcpy(header.magic, kPackMagic, sizeof(header.magic));
+    header.version = kPackVersion;
+    header.levelCount = static_cast<uint32_t>(levels.size());
+    header.entryCount = static_cast<uint32_t>(entries.size());
+    header.slotCount = std::bit_ceil(std::max<uint32_t>(16, header.entryCount * 2));
+    header.stringsSize = strings.size();
+
+    std::vector<Slot> slots(header.slotCount, Slot{ 0, 0 });
+    size_t const mask = slots.size() - 1;
+    for (size_t i = 0; i < entries.size(); ++i) {
+        size_t slot = entries[i].nameHash & mask;
+        while (slots[slot].entry != 0) slot = (slot + 1) & mask;
+        slots[slot] = { entries[i].nameHash, static_cast<uint32_t>(i + 1) };
+    }
+
+    uint64_t const tocSize = slots.size() * sizeof(Slot) + entries.size() * sizeof(EntryRecord) + levels.size() * sizeof(LevelRecord) + strings.size();
+    header.dataOffset = align(sizeof(Header) + tocSize);
+
+    std::string error;
+    bool const written = write_file_atomic(path, [&](std::ostream& file) {
+        // Payloads go first, the table of contents is written over the gap once their offsets are known
+        uint64_t offset = header.dataOffset;
+        std::vector<char> contents;
+        std::vector<std::byte> compressed;
+
+        for (size_t i = 0; i < entries.size() && !stopped(); ++i) {
+            EntryRecord& entry = entries[i];
+
+            std::error_code ec;
+            uint64_t const size = std::filesystem::file_size(sources[i], ec);
+            std::ifstream source(sources[i], std::ios::in | std::ios::binary);
+            contents.resize(static_cast<size_t>(ec ? 0 : size));
+            source.read(contents.data(), static_cast<std::streamsize>(contents.size()));
+
+            if (ec || !source) {
+                report.errors.push_back(path_to_string(sources[i]) + ": could not be read");
+                return false;
+            }
+
+            entry.size = contents.size();
+            entry.checksum = checksum(contents.data(), contents.size(), 0);
+
+            std::span<std::byte const> stored = std::as_bytes(std::span(contents));
+            if (compress && contents.size() >= kMinCompressSize) {
+                compressed = lz_compress(stored);
+                if (compressed.size() <= contents.size() - contents.size() / 8) {
+                    stored = compressed;
+                    entry.compression = kLz;
+                }
+            }
+
+            entry.offset = offset;
+            entry.storedSize = stored.size();
+
+            file.seekp(static_cast<std::streamoff>(offset));
+            file.write(reinterpret_cast<char const*>(stored.data()), static_cast<std::streamsize>(stored.size()));
+            offset = align(offset + stored.size());
+
+            ++report.files;
+            report.bytes += entry.size;
+            report.storedBytes += entry.storedSize;
+        }
+
+        // Also covers a listing that stopped before reaching every directory
+        if (stopped()) {
+            report.errors.push_back("cancelled, no pack was written");
+            return false;
+        }
+
+        uint64_t hash = 0;
+        hash = checksum(slots.data(), slots.size() * sizeof(Slot), hash);
+        hash = checksum(entries.data(), entries.size() * sizeof(EntryRecord), hash);
+        hash = checksum(levels.data(), levels.size() * sizeof(LevelRecord), hash);
+        hash = checksum(strings.data(), strings.size(), hash);
+        header.checksum = hash;
+
+        file.seekp(0);
+        file.write(reinterpret_cast<char const*>(&header), sizeof(header));
+        file.write(reinterpret_cast<char const*>(slots.data()), static_cast<std::streamsize>(slots.size() * sizeof(Slot)));
+        file.write(reinterpret_cast<char const*>(entries.data()), static_cast<std::streamsize>(entries.size() * sizeof(EntryRecord)));
+        file.write(reinterpret_cast<char const*>(levels.data()), static_cast<std::streamsize>(levels.size() * sizeof(LevelRecord)));
+        file.write(strings.data(), static_cast<std::streamsize>(strings.size()));
+
+        // An empty pack has no payload to extend the file up to the data offset
+        if (entries.empty()) {
+            file.seekp(static_cast<std::streamoff>(header.dataOffset - 1));
+            file.put('\0');
+        }
+
+        return true;
+    }, error);
+
+    if (!error.empty()) report.errors.push_back(error);
+    if (!written) return false;
+
+    report.levels = levels.size();
+    report.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return report.errors.empty();
+}
+
+std::vector<std::byte> lz_compress(std::span<std::byte const> input) {
+    unsigned char const* data = reinterpret_cast<unsigned char const*>(input.data());
+    size_t const size = input.size();
+
+    std::vector<std::byte> out;
+    out.reserve(size + size / 255 + 16);
+
+    auto const put = [&](size_t value) {
+        out.push_back(static_cast<std::byte>(value));
+    };
+
+    // Lengths that do not fit a token nibble continue in bytes, 255 meaning another byte follows
+    auto const put_length = [&](size_t length) {
+        for (; length >= 255; length -= 255) put(255);
+        put(length);
+    };
+
+    // A sequence is a token, its literals, then a match unless it is the last one
+    auto const emit = [&](size_t literalStart, size_t literalLength, size_t offset, size_t matchLength) {
+        size_t const matchCode = matchLength > 0 ? matchLength - kLzMinMatch : 0;
+        put(std::min<size_t>(literalLength, 15) << 4 | std::min<size_t>(matchCode, 15));
+        if (literalLength >= 15) put_length(literalLength - 15);
+        out.insert(out.end(), input.begin() + literalStart, input.begin() + literalStart + literalLength);
+
+        if (matchLength == 0) return;
+        put(offset & 0xff);
+        put(offset >> 8);
+        if (matchCode >= 15) put_length(matchCode - 15);
+    };
+
+    // Last position plus one of each hashed four byte prefix, zero when unseen
+    std::vector<uint32_t> table(size_t(1) << kLzHashBits, 0);
+
+    size_t anchor = 0;
+    size_t i = 0;
+    while (i + kLzMinMatch <= size) {
+        uint32_t word;
+        std::memcpy(&word, data + i, sizeof(word));
+        uint32_t const slot = (word * 2654435761u) >> (32 - kLzHashBits);
+
+        size_t const candidate = table[slot];
+        table[slot] = static_cast<uint32_t>(i + 1);
+
+        if (candidate == 0 || i - (candidate - 1) > kLzMaxOffset || std::memcmp(data + candidate - 1, data + i, kLzMinMatch) != 0) {
+            ++i;
+            continue;
+        }
+
+        size_t const from = candidate - 1;
+        size_t length = kLzMinMatch;
+        while (i + length < size && data[from + length] == data[i + length]) ++length;
+
+        emit(anchor, i - anchor, i - from, length);
+        i += length;
+        anchor = i;
+    }
+
+    emit(anchor, size - anchor, 0, 0);
+    return out;
+}
+
+bool lz_decompress(std::span<std::byte const> input, std::span<std::byte> output) {
+    unsigned char const* in = reinterpret_cast<unsigned char const*>(input.data());
+    unsigned char* out = reinterpret_cast<unsigned char*>(output.data());
+    size_t const inSize = input.size();
+    size_t const outSize = output.size();
+    size_t ip = 0;
+    size_t op = 0;
+
+    auto const read_length = [&](size_t& length) {
+        unsigned char byte;
+        do {
+            if (ip >= inSize) return false;
+            byte = in[ip++];
+            length += byte;
+        } while (byte == 255);
+        return true;
+    };
+
+    while (ip < inSize) {
+        unsigned const token = in[ip++];
+
+        size_t literals = token >> 4;
+        if (literals == 15 && !read_length(literals)) return false;
+        if (literals > inSize - ip || literals > outSize - op) return false;
+        if (literals > 0) std::memcpy(out + op, in + ip, literals);
+        ip += literals;
+        op += literals;
+
+        // Only the last sequence ends without a match
+        if (ip == inSize) break;
+
+        if (inSize - ip < 2) return false;
+        size_t const offset = in[ip] | static_cast<size_t>(in[ip + 1]) << 8;
+        ip += 2;
+
+        size_t length = token & 15;
+        if (length == 15 && !read_length(length)) return false;
+        length += kLzMinMatch;
+        if (offset == 0 || offset > op || length > outSize - op) return false;
+
+        // A match may overlap the bytes it produces, which then repeat
+        unsigned char const* from = out + op - offset;
+        if (offset >= length) {
+            std::memcpy(out + op, from, length);
+        }
+        else {
+            for (size_t k = 0; k < length; ++k)
+                out[op + k] = from[k];
+        }
+        op += length;
+    }
+
+    return op == outSize;
+}
+
+struct LevelPackJob::State {
+    std::atomic<bool> cancelled = false;
+    std::atomic<bool> finished = false;
+    // Owned by the pool task until `finished` is set
+    LevelPackReport report;
+};
+
+LevelPackJob::LevelPackJob(ThreadPool& pool) : mPool(pool) {
+}
+
+void LevelPackJob::export_pack(std::vector<std::filesystem::path> directories, std::filesystem::path pack, bool compress) {
+    if (running()) return;
+
+    auto state = std::make_shared<State>();
+    mState = state;
+
+    mPool.submit([state, directories = std::move(directories), pack = std::move(pack), compress]() {
+        LevelPack::write(pack, directories, compress, state->report, &state->cancelled);
+        state->finished.store(true, std::memory_order_release);
+        wake_main_thread();
+    });
+}
+
+void LevelPackJob::import_pack(std::filesystem::path pack, std::filesystem::path root) {
+    if (running()) return;
+
+    auto state = std::make_shared<State>();
+    mState = state;
+
+    mPool.submit([state, pack = std::move(pack), root = std::move(root)]() {
+        LevelPack reader;
+        if (reader.open(pack)) reader.extract(root, state->report, &state->cancelled);
+        else state->report.errors.push_back(path_to_string(pack) + ": not a level pack");
+
+        state->finished.store(true, std::memory_order_release);
+        wake_main_thread();
+    });
+}
+
+void LevelPackJob::cancel() {
+    if (mState) mState->cancelled.store(true, std::memory_order_relaxed);
+}
+
+bool LevelPackJob::poll() {
+    if (!mState || !mState->finished.load(std::memory_order_acquire)) return false;
+
+    mReport = std::move(mState->report);
+    mState.reset();
+    return true;
+}
+
+bool LevelPackJob::running() const {
+    return mState != nullptr;
+}
@@ -0,0 +1,152 @@
+#pragma once
+
+#include "te_level_list.hpp"
+#include "te_mapped_file.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+class ThreadPool;
+
+struct LevelPackReport {
+    size_t levels = 0;
+    size_t files = 0;
+    // Uncompressed, and as stored in the pack
+    uint64_t bytes = 0;
+    uint64_t storedBytes = 0;
+    double seconds = 0.0;
+    std::vector<std::string> errors;
+};
+
+// Many level directories in one file. Everything needed to list the levels sits at the
+// front: a table of file names open addressed by hash32, the file entries and each level's
+// details. Payloads follow, each aligned so a stored one can be used straight from the
+// mapping, a compressed one goes through a small lz decoder first.
+class LevelPack final {
+public:
+    struct Entry {
+        // `level directory/relative path` with forward slashes
+        std::string_view name;
+        uint32_t level = 0;
+        uint64_t size = 0;
+        uint64_t storedSize = 0;
+        bool compressed = false;
+    };
+
+    // Only the table of contents is read and checked, payloads are left to the os until used
+    bool open(std::filesystem::path const& path);
+    void close();
+
+    inline bool is_open() const { return mFile.is_open(); }
+
+    inline size_t level_count() const { return mLevels.size(); }
+    // `path` is the level's directory name
+    LevelView level(size_t index) const;
+    // Entries of one level are contiguous
+    std::pair<size_t, size_t> level_entries(size_t index) const;
+
+    inline size_t entry_count() const { return mEntries.size(); }
+    Entry entry(size_t index) const;
+    std::optional<size_t> find(std::string_view name) const;
+
+    // Uncompressed contents checked against the checksum taken when the pack was written
+    bool read(size_t index, std::vector<std::byte>& out) const;
+
+    // Writes each level into `root/directory`. A level that already has that name is moved aside
+    // and only deleted once the new one is in place, or put back if that fails. Once `cancelled`
+    // is set the level being unpacked is dropped and no further level is touched.
+    bool extract(std::filesystem::path const& root, LevelPackReport& report, std::atomic<bool> const* cancelled = nullptr) const;
+
+    // Packs every level found in `directories`, ones without valid level details are skipped
+    // and reported. The pack is written aside and renamed into place once complete, so
+    // setting `cancelled` leaves no pack behind.
+    static bool write(std::filesystem::path const& path, std::span<std::filesystem::path const> directories, bool compress, LevelPackReport& report, std::atomic<bool> const* cancelled = nullptr);
+private:
+    // Little endian on disk like the level snapshot, the header is followed by the slots,
+    // entries, levels and strings in that order
+    struct Slot {
+        uint32_t hash;
+        // Index into the entries plus one, zero marks an empty slot
+        uint32_t entry;
+    };
+
+    struct EntryRecord {
+        uint32_t nameOffset;
+        uint32_t nameLength;
+        uint32_t nameHash;
+        uint32_t level;
+        // From the start of the file
+        uint64_t offset;
+        uint64_t storedSize;
+        uint64_t size;
+        // Of the uncompressed contents
+        uint64_t checksum;
+        uint32_t compression;
+        uint32_t reserved;
+    };
+
+    // Strings in field order like `LevelList`, the path is the directory name
+    struct LevelRecord {
+        uint32_t offsets[5];
+        uint32_t lengths[5];
+        uint32_t firstEntry;
+        uint32_t entryCount;
+        int64_t modified;
+        uint64_t size;
+    };
+
+    static_assert(sizeof(Slot) == 8);
+    static_assert(sizeof(EntryRecord) == 56);
+    static_assert(sizeof(LevelRecord) == 64);
+
+    std::string_view string(uint32_t offset, uint32_t length) const;
+
+    MappedFile mFile;
+    std::span<Slot const> mSlots;
+    std::span<EntryRecord const> mEntries;
+    std::span<LevelRecord const> mLevels;
+    std::span<char const> mStrings;
+};
+
+// Byte oriented lz77, one token per literal run and match, matches reach back 64 KB
+std::vector<std::byte> lz_compress(std::span<std::byte const> input);
+// `output` has to be sized to the exact uncompressed size, false on malformed input
+bool lz_decompress(std::span<std::byte const> input, std::span<std::byte> output);
+
+// Runs one export or import at a time on the pool, `poll` picks up the result
+class LevelPackJob final {
+public:
+    explicit LevelPackJob(ThreadPool& pool);
+
+    LevelPackJob(LevelPackJob const&) = delete;
+    LevelPackJob& operator=(LevelPackJob const&) = delete;
+
+    // Both are ignored while a job is already running
+    void export_pack(std::vector<std::filesystem::path> directories, std::filesystem::path pack, bool compress);
+    void import_pack(std::filesystem::path pack, std::filesystem::path root);
+
+    // The running job stops at the next file, `poll` still reports it
+    void cancel();
+
+    // Returns true once when a job finished, its report is then in `report`
+    bool poll();
+
+    bool running() const;
+
+    inline std::optional<LevelPackReport> const& report() const { return mReport; }
+private:
+    struct State;
+
+    ThreadPool& mPool;
+    std::shared_ptr<State> mState;
+    std::optional<LevelPackReport> mReport;
+};
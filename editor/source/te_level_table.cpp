@@ -0,0 +1,200 @@
+#include "te_level_table.hpp"
+
+#include <algorithm>
+
+namespace {
+    // While a scan streams levels in the model refreshes at most this often, or less
+    // often on huge libraries so rebuilding never takes more than a fifth of the time
+    constexpr auto kRebuildInterval = std::chrono::milliseconds(250);
+    constexpr int kRebuildCostFactor = 4;
+
+    inline char to_lower(char c) {
+        return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+    }
+
+    inline bool is_digit(char c) {
+        return c >= '0' && c <= '9';
+    }
+
+    // Case insensitive and digit runs compare by value so `d10` sorts after `d9`
+    int natural_compare(std::string_view a, std::string_view b) {
+        size_t i = 0, j = 0;
+
+        while (i < a.size() && j < b.size()) {
+            if (is_digit(a[i]) && is_digit(b[j])) {
+                while (i < a.size() && a[i] == '0') ++i;
+                while (j < b.size() && b[j] == '0') ++j;
+
+                size_t runA = i, runB = j;
+                while (runA < a.size() && is_digit(a[runA])) ++runA;
+                while (runB < b.size() && is_digit(b[runB])) ++runB;
+
+                if (runA - i != runB - j) return runA - i < runB - j ? -1 : 1;
+
+                for (; i < runA; ++i, ++j)
+                    if (a[i] != b[j]) return a[i] < b[j] ? -1 : 1;
+                continue;
+            }
+
+            char const ca = to_lower(a[i]), cb = to_lower(b[j]);
+            if (ca != cb) return ca < cb ? -1 : 1;
+            ++i;
+            ++j;
+        }
+
+        size_t const restA = a.size() - i, restB = b.size() - j;
+        return restA == restB ? 0 : restA < restB ? -1 : 1;
+    }
+
+    // `needle` is already lower case
+    bool contains_icase(std::string_view haystack, std::string_view needle) {
+        if (needle.size() > haystack.size()) return false;
+
+        size_t const last = haystack.size() - needle.size();
+        for (size_t i = 0; i <= last; ++i) {
+            if (to_lower(haystack[i]) != needle[0]) continue;
+
+            size_t k = 1;
+            while (k < needle.size() && to_lower(haystack[i + k]) == needle[k]) ++k;
+            if (k == needle.size()) return true;
+        }
+
+        return false;
+    }
+
+    bool matches(LevelView const& level, std::string_view filter) {
+        return contains_icase(level.name, filter) || contains_icase(level.author, filter)
+            || contains_icase(level.difficulty, filter) || contains_icase(level.description, filter);
+    }
+}
+
+std::string_view level_column(LevelView const& level, LevelColumn column) {
+    switch (column) {
+    case LevelColumn::Difficulty: return level.difficulty;
+    case LevelColumn::Description: return level.description;
+    case LevelColumn::Author: return level.author;
+    default: return level.name;
+    }
+}
+
+std::vector<uint32_t> sort_levels(LevelList const& levels, LevelColumn column) {
+    // Keys are gathered next to their index so the sort does not chase through the arena
+    struct Entry {
+        std::string_view key;
+        std::string_view name;
+        uint32_t index;
+    };
+
+    std::vector<Entry> entries(levels.size());
+    for (size_t i = 0; i < levels.size(); ++i) {
+        LevelView const level = levels[i];
+        entries[i] = { level_column(level, column), level.name, static_cast<uint32_t>(i) };
+    }
+
+    // Ties fall back to the name then the index, so the order is total and std::sort stays deterministic
+    std::sort(entries.begin(), entries.end(), [column](Entry const& a, Entry const& b) {
+        int order = natural_compare(a.key, b.key);
+        if (order == 0 && column != LevelColumn::Name) order = natural_compare(a.name, b.name);
+        return order != 0 ? order < 0 : a.index < b.index;
+    });
+
+    std::vector<uint32_t> order(entries.size());
+    for (size_t i = 0; i < entries.size(); ++i)
+        order[i] = entries[i].index;
+
+    return order;
+}
+
+void LevelTableModel::update(LevelList const& levels, uint64_t generation, bool settled) {
+    auto const now = std::chrono::steady_clock::now();
+
+    bool const dataChanged = generation != mGeneration;
+    bool const filterChanged = mFilter != mAppliedFilter;
+
+    auto const interval = std::max<std::chrono::steady_clock::duration>(kRebuildInterval, mRebuildCost * kRebuildCostFactor);
+    if (dataChanged && !settled && !mDirty && !filterChanged && now - mLastRebuild < interval) {
+        // Keep showing the previous order, just never point past the end
+        std::erase_if(mRows, [&](uint32_t row) { return row >= levels.size(); });
+        return;
+    }
+
+    if (dataChanged) {
+        mGeneration = generation;
+        mLastRebuild = now;
+        match_all(levels);
+        mDirty = true;
+    }
+    else if (filterChanged) {
+        // Typing more characters can only remove rows, so only the current matches are rechecked
+        if (!mAppliedFilter.empty() && mFilter.starts_with(mAppliedFilter)) narrow(levels);
+        else match_all(levels);
+        mDirty = true;
+    }
+
+    mAppliedFilter = mFilter;
+
+    if (mDirty) {
+        rebuild_rows(levels);
+        mDirty = false;
+    }
+
+    if (dataChanged) mRebuildCost = std::chrono::steady_clock::now() - now;
+}
+
+void LevelTableModel::set_sort(LevelColumn column, bool descending) {
+    if (column == mSortColumn && descending == mSortDescending) return;
+
+    mSortColumn = column;
+    mSortDescending = descending;
+    mDirty = true;
+}
+
+void LevelTableModel::set_filter(std::string_view filter) {
+    mFilter.resize(filter.size());
+    std::transform(filter.begin(), filter.end(), mFilter.begin(), to_lower);
+}
+
+std::vector<uint32_t> const& LevelTableModel::permutation(LevelList const& levels, LevelColumn column) {
+    size_t const index = static_cast<size_t>(column);
+    auto& permutation = mPermutations[index];
+
+    if (mPermutationGenerations[index] != mGeneration || permutation.size() != levels.size()) {
+        // A freshly mapped snapshot carries the name order, the first frame never sorts
+        auto const saved = levels.name_order();
+        if (column == LevelColumn::Name && saved.size() == levels.size()) permutation.assign(saved.begin(), saved.end());
+        else permutation = sort_levels(levels, column);
+
+        mPermutationGenerations[index] = mGeneration;
+    }
+
+    return permutation;
+}
+
+void LevelTableModel::match_all(LevelList const& levels) {
+    mMatches.assign(levels.size(), 1);
+    if (mFilter.empty()) return;
+
+    for (size_t i = 0; i < levels.size(); ++i)
+        mMatches[i] = matches(levels[i], mFilter);
+}
+
+void LevelTableModel::narrow(LevelList const& levels) {
+    for (size_t i = 0; i < mMatches.size(); ++i)
+        if (mMatches[i]) mMatches[i] = matches(levels[i], mFilter);
+}
+
+void LevelTableModel::rebuild_rows(LevelList const& levels) {
+    auto const& order = permutation(levels, mSortColumn);
+
+    mRows.clear();
+    mRows.reserve(order.size());
+
+    if (mSortDescending) {
+        for (auto it = order.rbegin(); it != order.rend(); ++it)
+            if (mMatches[*it]) mRows.push_back(*it);
+    }
+    else {
+        for (uint32_t index : order)
+            if (mMatches[index]) mRows.push_back(index);
+    }
+}
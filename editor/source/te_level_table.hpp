@@ -0,0 +1,64 @@
+#pragma once
+
+#include "te_level.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+enum class LevelColumn {
+    Name,
+    Difficulty,
+    Description,
+    Author,
+    Count,
+};
+
+std::string_view level_column(LevelView const& level, LevelColumn column);
+
+// Level indices in ascending order of `column`, ties are broken by name and then index
+std::vector<uint32_t> sort_levels(LevelList const& levels, LevelColumn column);
+
+// Sorted and filtered row order for the level table. One permutation per column is
+// kept and only rebuilt when the library changes, flipping direction or switching to
+// an already built column is a single pass over that permutation.
+class LevelTableModel final {
+public:
+    // Call once per frame before reading `rows`
+    void update(LevelList const& levels, uint64_t generation, bool settled);
+
+    void set_sort(LevelColumn column, bool descending);
+    void set_filter(std::string_view filter);
+
+    inline std::string const& filter() const { return mFilter; }
+
+    // Indices into the level list, in display order
+    inline std::span<uint32_t const> rows() const { return mRows; }
+private:
+    std::vector<uint32_t> const& permutation(LevelList const& levels, LevelColumn column);
+    void match_all(LevelList const& levels);
+    void narrow(LevelList const& levels);
+    void rebuild_rows(LevelList const& levels);
+
+    static constexpr size_t kColumnCount = static_cast<size_t>(LevelColumn::Count);
+
+    std::array<std::vector<uint32_t>, kColumnCount> mPermutations;
+    std::array<uint64_t, kColumnCount> mPermutationGenerations{};
+
+    std::vector<uint8_t> mMatches;
+    std::vector<uint32_t> mRows;
+
+    LevelColumn mSortColumn = LevelColumn::Name;
+    bool mSortDescending = false;
+    std::string mFilter;
+    std::string mAppliedFilter;
+
+    uint64_t mGeneration = 0;
+    bool mDirty = true;
+    std::chrono::steady_clock::time_point mLastRebuild;
+    std::chrono::steady_clock::duration mRebuildCost{};
+};
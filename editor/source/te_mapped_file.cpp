@@ -0,0 +1,81 @@
+#include "te_mapped_file.hpp"
+
+#ifdef TE_WINDOWS
+#   include <Windows.h>
+#else
+#   include <fcntl.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <unistd.h>
+#endif
+
+bool MappedFile::open(std::filesystem::path const& path) {
+    close();
+
+#ifdef TE_WINDOWS
+    HANDLE const file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+        CloseHandle(file);
+        return false;
+    }
+
+    if (size.QuadPart > 0) {
+        // The view keeps the mapping alive, neither handle is needed past this point
+        HANDLE const mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping) {
+            mData = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            CloseHandle(mapping);
+        }
+
+        if (!mData) {
+            CloseHandle(file);
+            return false;
+        }
+    }
+
+    CloseHandle(file);
+    mSize = static_cast<size_t>(size.QuadPart);
+#else
+    int const file = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (file < 0) return false;
+
+    struct stat info;
+    if (::fstat(file, &info) != 0) {
+        ::close(file);
+        return false;
+    }
+
+    if (info.st_size > 0) {
+        void* data = ::mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+        if (data == MAP_FAILED) {
+            ::close(file);
+            return false;
+        }
+        mData = data;
+    }
+
+    // The mapping holds its own reference to the file
+    ::close(file);
+    mSize = static_cast<size_t>(info.st_size);
+#endif
+
+    mOpen = true;
+    return true;
+}
+
+void MappedFile::close() {
+    if (mData) {
+#ifdef TE_WINDOWS
+        UnmapViewOfFile(mData);
+#else
+        ::munmap(const_cast<void*>(mData), mSize);
+#endif
+    }
+
+    mData = nullptr;
+    mSize = 0;
+    mOpen = false;
+}
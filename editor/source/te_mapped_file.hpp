@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <span>
+#include <utility>
+
+// Read only view of a whole file, the os pages it in on demand
+class MappedFile final {
+public:
+    MappedFile() = default;
+    ~MappedFile() noexcept { close(); }
+
+    MappedFile(MappedFile const&) = delete;
+    MappedFile& operator=(MappedFile const&) = delete;
+
+    MappedFile(MappedFile&& other) noexcept { *this = std::move(other); }
+    MappedFile& operator=(MappedFile&& other) noexcept {
+        std::swap(mData, other.mData);
+        std::swap(mSize, other.mSize);
+        std::swap(mOpen, other.mOpen);
+        return *this;
+    }
+
+    // Empty files open fine and give an empty span
+    bool open(std::filesystem::path const& path);
+    void close();
+
+    inline bool is_open() const { return mOpen; }
+    inline size_t size() const { return mSize; }
+    inline std::span<std::byte const> bytes() const { return { static_cast<std::byte const*>(mData), mSize }; }
+private:
+    void const* mData = nullptr;
+    size_t mSize = 0;
+    bool mOpen = false;
+};
@@ -0,0 +1,218 @@
+#include "te_profiler.hpp"
+
+#ifdef TE_PROFILER
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+
+namespace {
+    // Zones kept per thread, a power of two
+    constexpr uint64_t kCapacity = 1 << 14;
+
+    // Fields are relaxed atomics so a reader racing the writer is defined, they compile to plain moves
+    struct Event {
+        std::atomic<char const*> name;
+        std::atomic<uint64_t> start;
+        std::atomic<uint64_t> end;
+    };
+
+    struct ThreadBuffer {
+        std::array<Event, kCapacity> events;
+        // Zones ever recorded, only the owning thread stores to it
+        std::atomic<uint64_t> head = 0;
+        std::atomic<char const*> name = nullptr;
+        std::atomic<uint32_t> id = 0;
+        // Set once the thread exits, the next new thread takes the buffer over and drops its zones
+        std::atomic<bool> retired = false;
+    };
+
+    struct Registry {
+        std::mutex mutex;
+        std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+        uint32_t nextId = 1;
+
+        // Ticks are converted to nanoseconds against this pair and a fresh one taken at capture time
+        uint64_t ticks = profiler_ticks();
+        int64_t nanoseconds = profiler_now();
+    };
+
+    // Leaked so threads exiting during shutdown never find it destroyed
+    Registry& registry() {
+        static Registry* registry = new Registry();
+        return *registry;
+    }
+
+    struct ThreadSlot {
+        ThreadBuffer* buffer = nullptr;
+
+        ~ThreadSlot() noexcept {
+            if (buffer) buffer->retired.store(true, std::memory_order_release);
+        }
+    };
+
+    // The plain pointer keeps the recording path free of thread_local initialization checks
+    thread_local ThreadBuffer* tBuffer = nullptr;
+    thread_local ThreadSlot tSlot;
+
+    ThreadBuffer* register_thread() {
+        Registry& registry = ::registry();
+        std::lock_guard lock(registry.mutex);
+
+        ThreadBuffer* buffer = nullptr;
+        for (auto const& candidate : registry.buffers) {
+            if (candidate->retired.load(std::memory_order_acquire)) {
+                buffer = candidate.get();
+                break;
+            }
+        }
+
+        if (!buffer) {
+            registry.buffers.push_back(std::make_unique<ThreadBuffer>());
+            buffer = registry.buffers.back().get();
+        }
+
+        // The previous owner is gone and capture holds the same lock, so its zones can be dropped here
+        buffer->head.store(0, std::memory_order_relaxed);
+        buffer->name.store(nullptr, std::memory_order_relaxed);
+        buffer->id.store(registry.nextId++, std::memory_order_relaxed);
+        buffer->retired.store(false, std::memory_order_relaxed);
+
+        tBuffer = buffer;
+        tSlot.buffer = buffer;
+        return buffer;
+    }
+
+    void append_json_string(std::string& out, std::string_view value) {
+        out += '"';
+        for (char c : value) {
+            if (c == '"' || c == '\\') out += '\\';
+            if (static_cast<unsigned char>(c) >= 0x20) out += c;
+        }
+        out += '"';
+    }
+}
+
+void profiler_record(char const* name, uint64_t start, uint64_t end) {
+    ThreadBuffer* buffer = tBuffer;
+    if (!buffer) buffer = register_thread();
+
+    uint64_t const head = buffer->head.load(std::memory_order_relaxed);
+    Event& event = buffer->events[head & (kCapacity - 1)];
+    event.name.store(name, std::memory_order_relaxed);
+    event.start.store(start, std::memory_order_relaxed);
+    event.end.store(end, std::memory_order_relaxed);
+    buffer->head.store(head + 1, std::memory_order_release);
+}
+
+void profiler_set_thread_name(char const* name) {
+    ThreadBuffer* buffer = tBuffer;
+    if (!buffer) buffer = register_thread();
+    buffer->name.store(name, std::memory_order_relaxed);
+}
+
+int64_t profiler_now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+std::vector<ProfileThread> profiler_capture(int64_t since) {
+    Registry& registry = ::registry();
+
+    uint64_t const ticks = profiler_ticks();
+    int64_t const nanoseconds = profiler_now();
+    double const rate = ticks != registry.ticks ? static_cast<double>(nanoseconds - registry.nanoseconds) / static_cast<double>(ticks - registry.ticks) : 1.0;
+    auto const to_nanoseconds = [&](uint64_t value) {
+        return registry.nanoseconds + static_cast<int64_t>(static_cast<double>(static_cast<int64_t>(value - registry.ticks)) * rate);
+    };
+
+    std::vector<ProfileThread> threads;
+    std::lock_guard lock(registry.mutex);
+
+    for (auto const& buffer : registry.buffers) {
+        uint64_t const head = buffer->head.load(std::memory_order_acquire);
+        uint64_t const first = head > kCapacity ? head - kCapacity : 0;
+
+        struct Raw {
+            char const* name;
+            uint64_t start;
+            uint64_t end;
+        };
+
+        std::vector<Raw> raw;
+        raw.reserve(static_cast<size_t>(head - first));
+        for (uint64_t i = first; i < head; ++i) {
+            Event const& event = buffer->events[i & (kCapacity - 1)];
+            raw.push_back({ event.name.load(std::memory_order_relaxed), event.start.load(std::memory_order_relaxed), event.end.load(std::memory_order_relaxed) });
+        }
+
+        // Slots the writer may have lapped while they were copied, including the one it is writing now
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t const after = buffer->head.load(std::memory_order_relaxed);
+        uint64_t const valid = after >= kCapacity ? after - kCapacity + 1 : 0;
+        size_t const skip = valid > first ? static_cast<size_t>(std::min(valid - first, static_cast<uint64_t>(raw.size()))) : 0;
+
+        ProfileThread thread;
+        thread.id = buffer->id.load(std::memory_order_relaxed);
+        char const* name = buffer->name.load(std::memory_order_relaxed);
+        thread.name = name ? name : "Thread " + std::to_string(thread.id);
+
+        for (size_t i = skip; i < raw.size(); ++i) {
+            int64_t const end = to_nanoseconds(raw[i].end);
+            if (end < since) continue;
+            thread.events.push_back({ raw[i].name, to_nanoseconds(raw[i].start), end });
+        }
+
+        if (thread.events.empty()) continue;
+
+        // Zones are recorded as they end, outer ones after the ones nested in them
+        std::sort(thread.events.begin(), thread.events.end(), [](ProfileEvent const& a, ProfileEvent const& b) {
+            return a.start != b.start ? a.start < b.start : a.end > b.end;
+        });
+        threads.emplace_back(std::move(thread));
+    }
+
+    return threads;
+}
+
+bool profiler_export_chrome_trace(std::filesystem::path const& path) {
+    std::vector<ProfileThread> const threads = profiler_capture();
+
+    int64_t origin = INT64_MAX;
+    for (auto const& thread : threads)
+        origin = std::min(origin, thread.events.front().start);
+
+    std::string out = "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+    bool first = true;
+
+    for (auto const& thread : threads) {
+        char line[160];
+
+        snprintf(line, sizeof(line), "%s{\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"name\":\"thread_name\",\"args\":{\"name\":", first ? "" : ",\n", thread.id);
+        out += line;
+        append_json_string(out, thread.name);
+        out += "}}";
+        first = false;
+
+        for (auto const& event : thread.events) {
+            // Microseconds, the format's unit
+            snprintf(line, sizeof(line), ",\n{\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"name\":",
+                thread.id, static_cast<double>(event.start - origin) / 1e3, static_cast<double>(event.end - event.start) / 1e3);
+            out += line;
+            append_json_string(out, event.name);
+            out += '}';
+        }
+    }
+
+    out += "\n]}\n";
+
+    std::ofstream file(path, std::ios::out | std::ios::binary);
+    if (!file) return false;
+    file.write(out.data(), static_cast<std::streamsize>(out.size()));
+    return static_cast<bool>(file);
+}
+
+#endif
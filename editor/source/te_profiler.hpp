@@ -0,0 +1,86 @@
+#pragma once
+
+// Scoped zones recorded into a lock free ring buffer per thread. On in debug builds, define
+// TE_PROFILER to keep it in release. Without it the macros expand to nothing at all.
+#if defined(TE_DEBUG) && !defined(TE_PROFILER)
+#   define TE_PROFILER
+#endif
+
+#ifdef TE_PROFILER
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#   ifdef _MSC_VER
+#       include <intrin.h>
+#   else
+#       include <x86intrin.h>
+#   endif
+#endif
+
+#define TE_PROFILE_CONCAT_INNER(a, b) a##b
+#define TE_PROFILE_CONCAT(a, b) TE_PROFILE_CONCAT_INNER(a, b)
+
+// `name` has to be a string literal, only the pointer is stored
+#define TE_PROFILE_ZONE(name) ProfileZone const TE_PROFILE_CONCAT(teProfileZone, __LINE__)(name)
+#define TE_PROFILE_THREAD(name) profiler_set_thread_name(name)
+
+// Raw timestamp, the time stamp counter where there is one since it is several times cheaper than the os clock
+inline uint64_t profiler_ticks() {
+#if defined(__x86_64__) || defined(_M_X64)
+    return __rdtsc();
+#else
+    return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+
+// Called by the zone destructor, the first call on a thread registers its buffer
+void profiler_record(char const* name, uint64_t start, uint64_t end);
+
+// Shown in the panel and the trace instead of the numeric id, `name` has to outlive the thread
+void profiler_set_thread_name(char const* name);
+
+class ProfileZone final {
+public:
+    explicit ProfileZone(char const* name) : mName(name), mStart(profiler_ticks()) {}
+    ~ProfileZone() noexcept { profiler_record(mName, mStart, profiler_ticks()); }
+
+    ProfileZone(ProfileZone const&) = delete;
+    ProfileZone& operator=(ProfileZone const&) = delete;
+private:
+    char const* mName;
+    uint64_t mStart;
+};
+
+struct ProfileEvent {
+    char const* name;
+    // Nanoseconds on the steady clock
+    int64_t start;
+    int64_t end;
+};
+
+struct ProfileThread {
+    std::string name;
+    uint32_t id = 0;
+    // Ordered by start, a zone always comes before the zones nested in it
+    std::vector<ProfileEvent> events;
+};
+
+int64_t profiler_now();
+
+// Copies every zone still in the buffers that ended after `since`, safe while threads keep recording
+std::vector<ProfileThread> profiler_capture(int64_t since = 0);
+
+// Chrome's trace event format, opens in chrome://tracing and Perfetto
+bool profiler_export_chrome_trace(std::filesystem::path const& path);
+
+#else
+
+#define TE_PROFILE_ZONE(name) ((void)0)
+#define TE_PROFILE_THREAD(name) ((void)0)
+
+#endif
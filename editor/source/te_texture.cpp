@@ -0,0 +1,282 @@
+#include "te_texture.hpp"
+#include "te_hash.hpp"
+#include "te_profiler.hpp"
+#include "te_thread_pool.hpp"
+#include "te_util.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+namespace {
+    // 2x2 box filter, odd edges are clamped
+    Image halve(Image const& source) {
+        int const width = std::max(source.width() / 2, 1);
+        int const height = std::max(source.height() / 2, 1);
+        Image result(width, height);
+
+        stbi_uc const* in = source.pixels();
+        stbi_uc* out = result.pixels();
+        size_t const stride = static_cast<size_t>(source.width()) * 4;
+
+        for (int y = 0; y < height; ++y) {
+            int const y0 = std::min(y * 2, source.height() - 1);
+            int const y1 = std::min(y * 2 + 1, source.height() - 1);
+
+            for (int x = 0; x < width; ++x) {
+                int const x0 = std::min(x * 2, source.width() - 1);
+                int const x1 = std::min(x * 2 + 1, source.width() - 1);
+
+                for (int c = 0; c < 4; ++c) {
+                    unsigned int const sum = in[y0 * stride + x0 * 4 + c] + in[y0 * stride + x1 * 4 + c]
+                        + in[y1 * stride + x0 * 4 + c] + in[y1 * stride + x1 * 4 + c];
+                    out[(static_cast<size_t>(y) * width + x) * 4 + c] = static_cast<stbi_uc>((sum + 2) / 4);
+                }
+            }
+        }
+
+        return result;
+    }
+}
+
+TextureStreamer::TextureStreamer(ThreadPool& pool, size_t uploadBudget) : mPool(pool), mUploadBudget(std::max<size_t>(uploadBudget, 4096)) {
+}
+
+void TextureStreamer::init() {
+    constexpr GLbitfield kFlags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+    for (Slot& slot : mSlots) {
+        glCreateBuffers(1, &slot.buffer);
+        glNamedBufferStorage(slot.buffer, static_cast<GLsizeiptr>(mUploadBudget), nullptr, kFlags);
+        slot.mapped = glMapNamedBufferRange(slot.buffer, 0, static_cast<GLsizeiptr>(mUploadBudget), kFlags);
+    }
+
+    // Dim checkerboard, obviously not real content
+    constexpr uint32_t kPixels[4] = { 0xff303030, 0xff505050, 0xff505050, 0xff303030 };
+    glCreateTextures(GL_TEXTURE_2D, 1, &mPlaceholder);
+    glTextureStorage2D(mPlaceholder, 1, GL_RGBA8, 2, 2);
+    glTextureSubImage2D(mPlaceholder, 0, 0, 0, 2, 2, GL_RGBA, GL_UNSIGNED_BYTE, kPixels);
+    glTextureParameteri(mPlaceholder, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTextureParameteri(mPlaceholder, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+}
+
+void TextureStreamer::uninit() {
+    for (Entry& entry : mEntries) {
+        if (entry.texture) glDeleteTextures(1, &entry.texture);
+        entry.texture = 0;
+    }
+
+    for (Slot& slot : mSlots) {
+        if (slot.fence) glDeleteSync(slot.fence);
+        glUnmapNamedBuffer(slot.buffer);
+        glDeleteBuffers(1, &slot.buffer);
+        slot = Slot{};
+    }
+
+    glDeleteTextures(1, &mPlaceholder);
+    mPlaceholder = 0;
+}
+
+std::string TextureStreamer::key(std::filesystem::path const& path, int maxDimension) {
+    std::string key = path_to_string(path);
+    if (maxDimension > 0) key += '@' + std::to_string(maxDimension);
+    return key;
+}
+
+TextureId TextureStreamer::load(std::filesystem::path const& path, int maxDimension) {
+    std::string key = TextureStreamer::key(path, maxDimension);
+    if (auto it = mLookup.find(key); it != mLookup.end()) return it->second;
+
+    TextureId id;
+    if (mFree.empty()) {
+        id = static_cast<TextureId>(mEntries.size());
+        mEntries.emplace_back();
+    }
+    else {
+        id = mFree.back();
+        mFree.pop_back();
+    }
+
+    Entry& entry = mEntries[id];
+    entry.key = key;
+    entry.state = TextureState::Decoding;
+    mLookup.emplace(std::move(key), id);
+    ++mDecoding;
+
+    mPool.submit([queue = mDecodes, id, generation = entry.generation, path, maxDimension]() {
+        TE_PROFILE_ZONE("Texture Decode");
+
+        std::ifstream file(path, std::ios::in | std::ios::binary);
+        std::vector<unsigned char> const bytes{ std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
+
+        uint32_t const contentHash = hash32(bytes.data(), static_cast<unsigned int>(bytes.size()));
+        Image image(bytes.data(), bytes.size());
+
+        if (maxDimension > 0) {
+            while (image.pixels() && (image.width() > maxDimension || image.height() > maxDimension))
+                image = halve(image);
+        }
+
+        {
+            std::lock_guard lock(queue->mutex);
+            queue->done.push_back({ id, generation, contentHash, std::move(image) });
+        }
+        wake_main_thread();
+    });
+
+    return id;
+}
+
+void TextureStreamer::release(TextureId id) {
+    Entry* entry = find(id);
+    if (!entry) return;
+
+    if (entry->texture) glDeleteTextures(1, &entry->texture);
+    if (entry->state == TextureState::Uploading) std::erase(mUploads, id);
+
+    if (auto it = mLookup.find(entry->key); it != mLookup.end() && it->second == id) mLookup.erase(it);
+
+    // Bumping the generation drops a decode that is still in flight
+    uint32_t const generation = entry->generation + 1;
+    *entry = Entry();
+    entry->generation = generation;
+    mFree.push_back(id);
+}
+
+void TextureStreamer::forget(std::filesystem::path const& path, int maxDimension) {
+    mLookup.erase(key(path, maxDimension));
+}
+
+TextureStreamer::Entry* TextureStreamer::find(TextureId id) {
+    if (id >= mEntries.size() || mEntries[id].key.empty()) return nullptr;
+    return &mEntries[id];
+}
+
+TextureStreamer::Entry const* TextureStreamer::find(TextureId id) const {
+    if (id >= mEntries.size() || mEntries[id].key.empty()) return nullptr;
+    return &mEntries[id];
+}
+
+GLuint TextureStreamer::texture(TextureId id) const {
+    Entry const* entry = find(id);
+    if (!entry || entry->state != TextureState::Ready) return mPlaceholder;
+    return entry->texture;
+}
+
+TextureState TextureStreamer::state(TextureId id) const {
+    Entry const* entry = find(id);
+    return entry ? entry->state : TextureState::Failed;
+}
+
+int TextureStreamer::width(TextureId id) const {
+    Entry const* entry = find(id);
+    return entry ? entry->width : 0;
+}
+
+int TextureStreamer::height(TextureId id) const {
+    Entry const* entry = find(id);
+    return entry ? entry->height : 0;
+}
+
+uint32_t TextureStreamer::content_hash(TextureId id) const {
+    Entry const* entry = find(id);
+    return entry ? entry->contentHash : 0;
+}
+
+size_t TextureStreamer::bytes(TextureId id) const {
+    Entry const* entry = find(id);
+    if (!entry || !entry->texture) return 0;
+    return static_cast<size_t>(entry->width) * entry->height * 4;
+}
+
+bool TextureStreamer::busy() const {
+    return mDecoding > 0 || !mUploads.empty();
+}
+
+void TextureStreamer::update() {
+    TE_PROFILE_ZONE("Texture Update");
+
+    std::vector<Decoded> decoded;
+    {
+        std::lock_guard lock(mDecodes->mutex);
+        decoded.swap(mDecodes->done);
+    }
+
+    for (Decoded& result : decoded) {
+        --mDecoding;
+
+        Entry* entry = find(result.id);
+        if (!entry || entry->generation != result.generation) continue;
+
+        entry->contentHash = result.contentHash;
+
+        if (!result.image.pixels()) {
+            entry->state = TextureState::Failed;
+            continue;
+        }
+
+        entry->width = result.image.width();
+        entry->height = result.image.height();
+        entry->image = std::move(result.image);
+        entry->state = TextureState::Uploading;
+        mUploads.push_back(result.id);
+    }
+
+    if (mUploads.empty()) return;
+
+    Slot& slot = mSlots[mSlotIndex];
+    if (slot.fence) {
+        // Still being read by the gpu, try again next frame rather than wait
+        if (glClientWaitSync(slot.fence, 0, 0) == GL_TIMEOUT_EXPIRED) return;
+        glDeleteSync(slot.fence);
+        slot.fence = nullptr;
+    }
+
+    size_t offset = 0;
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer);
+
+    while (!mUploads.empty()) {
+        Entry& entry = mEntries[mUploads.front()];
+        size_t const rowBytes = static_cast<size_t>(entry.width) * 4;
+
+        if (!entry.texture) {
+            glCreateTextures(GL_TEXTURE_2D, 1, &entry.texture);
+            glTextureStorage2D(entry.texture, 1, GL_RGBA8, entry.width, entry.height);
+            glTextureParameteri(entry.texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        }
+
+        int rows = std::min(entry.height - entry.rowsUploaded, static_cast<int>((mUploadBudget - offset) / rowBytes));
+        stbi_uc const* source = entry.image.pixels() + rowBytes * entry.rowsUploaded;
+
+        if (rows == 0) {
+            if (offset > 0) break;
+
+            // A single row wider than the whole buffer, send it straight from client memory
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            glTextureSubImage2D(entry.texture, 0, 0, entry.rowsUploaded, entry.width, 1, GL_RGBA, GL_UNSIGNED_BYTE, source);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer);
+            rows = 1;
+        }
+        else {
+            size_t const bytes = rowBytes * rows;
+            std::memcpy(static_cast<unsigned char*>(slot.mapped) + offset, source, bytes);
+            glTextureSubImage2D(entry.texture, 0, 0, entry.rowsUploaded, entry.width, rows, GL_RGBA, GL_UNSIGNED_BYTE, reinterpret_cast<void const*>(offset));
+            offset += bytes;
+        }
+
+        entry.rowsUploaded += rows;
+        if (entry.rowsUploaded < entry.height) break;
+
+        entry.state = TextureState::Ready;
+        entry.image = Image();
+        mUploads.pop_front();
+    }
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    if (offset > 0) {
+        slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        mSlotIndex = (mSlotIndex + 1) % kSlotCount;
+    }
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <glad/gl.h>
+
+#include "te_image.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class ThreadPool;
+
+using TextureId = uint32_t;
+constexpr TextureId kInvalidTexture = ~TextureId(0);
+
+enum class TextureState {
+    Decoding,
+    Uploading,
+    Ready,
+    Failed,
+};
+
+// Decodes images on the thread pool and streams them to the gpu a few rows at a time
+// through persistently mapped pixel buffers. Until a texture is fully uploaded it
+// resolves to a placeholder, so the render thread never waits on a decode or a copy.
+class TextureStreamer final {
+public:
+    // `uploadBudget` is the most bytes copied to the gpu per `update`
+    explicit TextureStreamer(ThreadPool& pool, size_t uploadBudget = 2 * 1024 * 1024);
+    ~TextureStreamer() noexcept = default;
+
+    TextureStreamer(TextureStreamer const&) = delete;
+    TextureStreamer& operator=(TextureStreamer const&) = delete;
+
+    // Creates and destroys the gl objects, needs a current context
+    void init();
+    void uninit();
+
+    // Loading the same path and size twice returns the same id. A non-zero `maxDimension`
+    // halves the image on the worker until it fits, handy for thumbnails.
+    TextureId load(std::filesystem::path const& path, int maxDimension = 0);
+    void release(TextureId id);
+
+    // The next load of this path decodes it again, ids already handed out stay valid
+    void forget(std::filesystem::path const& path, int maxDimension = 0);
+
+    // The placeholder until the upload has finished
+    GLuint texture(TextureId id) const;
+    TextureState state(TextureId id) const;
+    int width(TextureId id) const;
+    int height(TextureId id) const;
+
+    // Hash of the encoded file, valid once decoded
+    uint32_t content_hash(TextureId id) const;
+    // Gpu memory held by the texture
+    size_t bytes(TextureId id) const;
+
+    // Picks up finished decodes and spends this frame's upload budget, call once per frame
+    void update();
+
+    // True while decodes or uploads are outstanding, the event loop should keep ticking
+    bool busy() const;
+private:
+    struct Entry {
+        std::string key;
+        uint32_t generation = 0;
+        uint32_t contentHash = 0;
+        TextureState state = TextureState::Failed;
+        GLuint texture = 0;
+        int width = 0, height = 0;
+        int rowsUploaded = 0;
+        Image image;
+    };
+
+    struct Decoded {
+        TextureId id;
+        uint32_t generation;
+        uint32_t contentHash;
+        Image image;
+    };
+
+    // Written by the workers, drained by `update`
+    struct DecodeQueue {
+        std::mutex mutex;
+        std::vector<Decoded> done;
+    };
+
+    // Each frame fills one buffer and fences it, a buffer is only reused once the gpu is done reading it
+    struct Slot {
+        GLuint buffer = 0;
+        void* mapped = nullptr;
+        GLsync fence = nullptr;
+    };
+
+    static constexpr size_t kSlotCount = 3;
+
+    static std::string key(std::filesystem::path const& path, int maxDimension);
+
+    Entry* find(TextureId id);
+    Entry const* find(TextureId id) const;
+
+    ThreadPool& mPool;
+    size_t mUploadBudget;
+
+    std::vector<Entry> mEntries;
+    std::vector<TextureId> mFree;
+    std::unordered_map<std::string, TextureId> mLookup;
+    std::deque<TextureId> mUploads;
+    std::shared_ptr<DecodeQueue> mDecodes = std::make_shared<DecodeQueue>();
+    size_t mDecoding = 0;
+
+    std::array<Slot, kSlotCount> mSlots{};
+    size_t mSlotIndex = 0;
+    GLuint mPlaceholder = 0;
+};
@@ -0,0 +1,138 @@
+#include "te_texture_cache.hpp"
+#include "te_util.hpp"
+
+#include <algorithm>
+#include <array>
+
+namespace {
+    constexpr std::array<int, 3> kMaxDimension = { 0, 256, 64 };
+
+    constexpr std::array<TextureTier, 3> kTiers = { TextureTier::Full, TextureTier::Preview, TextureTier::Thumbnail };
+
+    int max_dimension(TextureTier tier) {
+        return kMaxDimension[static_cast<size_t>(tier)];
+    }
+}
+
+TextureCache::TextureCache(TextureStreamer& streamer, size_t budgetBytes) : mStreamer(streamer), mBudget(budgetBytes) {
+}
+
+std::string TextureCache::key(std::filesystem::path const& path, TextureTier tier) {
+    std::string key = path_to_string(path);
+    key += '\n';
+    key += static_cast<char>('0' + static_cast<int>(tier));
+    return key;
+}
+
+GLuint TextureCache::get(std::filesystem::path const& path, TextureTier tier) {
+    auto [it, inserted] = mEntries.try_emplace(key(path, tier));
+    Entry& entry = it->second;
+
+    if (inserted) {
+        ++mStats.misses;
+        entry.id = mStreamer.load(path, max_dimension(tier));
+
+        Texture& texture = mTextures[entry.id];
+        if (texture.references++ == 0) {
+            texture.owner = it->first;
+            mLoading.push_back(entry.id);
+        }
+    }
+    else {
+        ++mStats.hits;
+    }
+
+    entry.lastUsed = mFrame;
+    return mStreamer.texture(entry.id);
+}
+
+void TextureCache::invalidate(std::filesystem::path const& path) {
+    for (TextureTier tier : kTiers) {
+        auto it = mEntries.find(key(path, tier));
+        if (it == mEntries.end()) continue;
+
+        // Other files with the old contents may keep the texture alive, it must not be found under this path again
+        mStreamer.forget(path, max_dimension(tier));
+        drop(it->second.id);
+        mEntries.erase(it);
+    }
+}
+
+void TextureCache::resolve(TextureId id) {
+    Texture& texture = mTextures[id];
+
+    if (mStreamer.state(id) != TextureState::Ready) {
+        // Failed loads stay cached so they are not retried every frame
+        texture.resident = true;
+        return;
+    }
+
+    int const width = mStreamer.width(id);
+    int const height = mStreamer.height(id);
+    uint64_t const contentKey = (static_cast<uint64_t>(mStreamer.content_hash(id)) << 32) ^ (static_cast<uint64_t>(width) << 16) ^ static_cast<uint64_t>(height);
+
+    if (auto found = mByContent.find(contentKey); found != mByContent.end()) {
+        TextureId const shared = found->second;
+        mEntries[texture.owner].id = shared;
+        ++mTextures[shared].references;
+        ++mStats.shared;
+
+        mTextures.erase(id);
+        mStreamer.release(id);
+        return;
+    }
+
+    texture.resident = true;
+    texture.contentKey = contentKey;
+    texture.bytes = mStreamer.bytes(id);
+    mByContent.emplace(contentKey, id);
+    mStats.bytes += texture.bytes;
+}
+
+void TextureCache::drop(TextureId id) {
+    auto it = mTextures.find(id);
+    if (it == mTextures.end() || --it->second.references > 0) return;
+
+    Texture const& texture = it->second;
+    if (texture.resident) {
+        mStats.bytes -= texture.bytes;
+        if (auto found = mByContent.find(texture.contentKey); found != mByContent.end() && found->second == id) mByContent.erase(found);
+    }
+    else {
+        std::erase(mLoading, id);
+    }
+
+    mTextures.erase(it);
+    mStreamer.release(id);
+}
+
+void TextureCache::end_frame() {
+    std::erase_if(mLoading, [this](TextureId id) {
+        TextureState const state = mStreamer.state(id);
+        if (state == TextureState::Decoding || state == TextureState::Uploading) return false;
+
+        resolve(id);
+        return true;
+    });
+
+    if (mStats.bytes > mBudget) {
+        // Anything drawn this frame is on screen and stays, even past the budget
+        std::vector<std::pair<uint64_t, std::string const*>> candidates;
+        for (auto const& [key, entry] : mEntries)
+            if (entry.lastUsed < mFrame) candidates.emplace_back(entry.lastUsed, &key);
+
+        std::sort(candidates.begin(), candidates.end());
+
+        for (auto const& candidate : candidates) {
+            if (mStats.bytes <= mBudget) break;
+
+            auto it = mEntries.find(*candidate.second);
+            drop(it->second.id);
+            mEntries.erase(it);
+            ++mStats.evictions;
+        }
+    }
+
+    mStats.textures = mTextures.size();
+    ++mFrame;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "te_texture.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+enum class TextureTier {
+    Full,
+    // Longest side at most 256 pixels
+    Preview,
+    // Longest side at most 64 pixels, for table rows
+    Thumbnail,
+};
+
+// Textures looked up by source path, files with identical contents share one gpu texture.
+// Whatever was not drawn in the current frame may be evicted, least recently used first,
+// once the resident textures go over the memory budget.
+class TextureCache final {
+public:
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+        // Textures that turned out to match one already resident
+        uint64_t shared = 0;
+        size_t textures = 0;
+        size_t bytes = 0;
+    };
+
+    TextureCache(TextureStreamer& streamer, size_t budgetBytes);
+
+    TextureCache(TextureCache const&) = delete;
+    TextureCache& operator=(TextureCache const&) = delete;
+
+    // Marks the texture as on screen this frame, the placeholder is returned while it loads
+    GLuint get(std::filesystem::path const& path, TextureTier tier = TextureTier::Full);
+
+    // Drops every tier of a file that changed on disk
+    void invalidate(std::filesystem::path const& path);
+
+    // Call once per frame after drawing, evicts if over budget and starts the next frame
+    void end_frame();
+
+    inline size_t budget() const { return mBudget; }
+    inline void set_budget(size_t bytes) { mBudget = bytes; }
+    inline Stats const& stats() const { return mStats; }
+private:
+    struct Entry {
+        TextureId id = kInvalidTexture;
+        uint64_t lastUsed = 0;
+    };
+
+    struct Texture {
+        uint32_t references = 0;
+        size_t bytes = 0;
+        // Set once the upload finished and the content hash was checked
+        bool resident = false;
+        uint64_t contentKey = 0;
+        // Entry that requested the texture, the only reference until it is resident
+        std::string owner;
+    };
+
+    static std::string key(std::filesystem::path const& path, TextureTier tier);
+
+    // Shares a finished texture with an identical resident one or makes it resident itself
+    void resolve(TextureId id);
+    void drop(TextureId id);
+
+    TextureStreamer& mStreamer;
+    size_t mBudget;
+
+    std::unordered_map<std::string, Entry> mEntries;
+    std::unordered_map<TextureId, Texture> mTextures;
+    // Content hash and size to the texture holding it
+    std::unordered_map<uint64_t, TextureId> mByContent;
+    std::vector<TextureId> mLoading;
+
+    uint64_t mFrame = 1;
+    Stats mStats;
+};
@@ -0,0 +1,65 @@
+#include "te_thread_pool.hpp"
+#include "te_profiler.hpp"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(unsigned int threadCount) {
+    if (threadCount == 0) threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+    mThreads.reserve(threadCount);
+    for (unsigned int i = 0; i < threadCount; ++i)
+        mThreads.emplace_back(&ThreadPool::worker, this);
+}
+
+ThreadPool::~ThreadPool() noexcept {
+    {
+        std::lock_guard lock(mMutex);
+        mStopping = true;
+    }
+
+    mCondition.notify_all();
+
+    for (auto& thread : mThreads)
+        thread.join();
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    {
+        std::lock_guard lock(mMutex);
+        mTasks.emplace_back(std::move(task));
+    }
+
+    mCondition.notify_one();
+}
+
+void ThreadPool::wait_idle() {
+    std::unique_lock lock(mMutex);
+    mIdleCondition.wait(lock, [this]() { return mTasks.empty() && mBusy == 0; });
+}
+
+void ThreadPool::worker() {
+    TE_PROFILE_THREAD("Pool Worker");
+
+    while (true) {
+        std::function<void()> task;
+
+        {
+            std::unique_lock lock(mMutex);
+            mCondition.wait(lock, [this]() { return mStopping || !mTasks.empty(); });
+            // Queued work still runs while stopping, saves are often submitted right before their owner goes away
+            if (mTasks.empty()) return;
+
+            task = std::move(mTasks.front());
+            mTasks.pop_front();
+            ++mBusy;
+        }
+
+        task();
+        task = nullptr;
+
+        {
+            std::lock_guard lock(mMutex);
+            if (--mBusy == 0 && mTasks.empty()) mIdleCondition.notify_all();
+        }
+    }
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of workers draining a shared fifo. Destruction waits for every queued task,
+// including ones submitted by tasks while it waits.
+class ThreadPool final {
+public:
+    // 0 uses every core
+    explicit ThreadPool(unsigned int threadCount = 0);
+    ~ThreadPool() noexcept;
+
+    ThreadPool(ThreadPool const&) = delete;
+    ThreadPool& operator=(ThreadPool const&) = delete;
+
+    void submit(std::function<void()> task);
+    // Blocks until the queue is empty and no task is running, tasks may still be submitted meanwhile
+    void wait_idle();
+
+    inline unsigned int size() const { return static_cast<unsigned int>(mThreads.size()); }
+private:
+    void worker();
+
+    std::vector<std::thread> mThreads;
+    std::deque<std::function<void()>> mTasks;
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    std::condition_variable mIdleCondition;
+    unsigned int mBusy = 0;
+    bool mStopping = false;
+};
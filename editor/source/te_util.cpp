@@ -0,0 +1,149 @@
+#include "te_util.hpp"
+
+#ifdef TE_WINDOWS
+#   include <Windows.h>
+#else
+#   include <unistd.h>
+#endif
+
+#include <atomic>
+#include <bit>
+#include <cstdio>
+#include <fstream>
+#include <thread>
+
+namespace {
+    std::atomic<void (*)()> gWakeHandler = nullptr;
+    // Calls that may still be inside the handler, sequentially consistent with the handler itself
+    std::atomic<int> gWaking = 0;
+
+    // Numbers the temp files of this process
+    std::atomic<uint64_t> gTempCounter = 0;
+
+    unsigned long process_id() {
+#ifdef TE_WINDOWS
+        return GetCurrentProcessId();
+#else
+        return static_cast<unsigned long>(getpid());
+#endif
+    }
+}
+
+std::string path_to_string(std::filesystem::path const& path) {
+    auto const u8string = path.generic_u8string();
+    return std::string(reinterpret_cast<char const*>(u8string.data()), u8string.cend() - u8string.cbegin());
+}
+
+void set_wake_handler(void (*handler)()) {
+    gWakeHandler.store(handler);
+
+    // A thread that loaded the old handler before the store may still be running it
+    while (gWaking.load() > 0) std::this_thread::yield();
+}
+
+void wake_main_thread() {
+    gWaking.fetch_add(1);
+    if (auto handler = gWakeHandler.load()) handler();
+    gWaking.fetch_sub(1);
+}
+
+void write_u32(std::ostream& stream, uint32_t value) {
+    stream.write(reinterpret_cast<char const*>(&value), sizeof(value));
+}
+
+void write_u64(std::ostream& stream, uint64_t value) {
+    stream.write(reinterpret_cast<char const*>(&value), sizeof(value));
+}
+
+void write_string(std::ostream& stream, std::string const& value) {
+    write_u32(stream, static_cast<uint32_t>(value.size()));
+    stream.write(value.data(), value.size());
+}
+
+bool file_stamp(std::filesystem::path const& path, uint64_t& size, int64_t& modified) {
+    std::error_code ec;
+    size = std::filesystem::file_size(path, ec);
+    if (ec) return false;
+    modified = std::filesystem::last_write_time(path, ec).time_since_epoch().count();
+    return !ec;
+}
+
+bool write_file_atomic(std::filesystem::path const& path, std::function<bool(std::ostream&)> const& write, std::string& error) {
+    // Two writers of one file, on two threads or in two processes, each get their own temp file
+    char unique[48];
+    snprintf(unique, sizeof(unique), ".%lu-%llu.tmp", process_id(), static_cast<unsigned long long>(gTempCounter.fetch_add(1, std::memory_order_relaxed)));
+
+    std::filesystem::path temp = path;
+    temp += unique;
+
+    std::error_code ec;
+    {
+        std::ofstream file(temp, std::ios::out | std::ios::binary);
+        if (!file) {
+            error = path_to_string(temp) + ": could not be created";
+            return false;
+        }
+
+        bool const written = write(file);
+        if (written && !file) error = path_to_string(temp) + ": could not be written";
+
+        if (!written || !file) {
+            file.close();
+            std::filesystem::remove(temp, ec);
+            return false;
+        }
+    }
+
+    std::filesystem::rename(temp, path, ec);
+    if (ec) {
+        error = path_to_string(path) + ": " + ec.message();
+        std::filesystem::remove(temp, ec);
+        return false;
+    }
+
+    return true;
+}
+
+bool write_file_atomic(std::filesystem::path const& path, std::function<bool(std::ostream&)> const& write) {
+    std::string error;
+    return write_file_atomic(path, write, error);
+}
+
+namespace {
+    constexpr uint64_t kChecksumMultiplier = 0x9e3779b97f4a7c15ull;
+
+    uint64_t checksum_mix(uint64_t state, uint64_t word) {
+        return std::rotl(state ^ (word * kChecksumMultiplier), 29) * kChecksumMultiplier;
+    }
+}
+
+uint64_t checksum(void const* data, size_t size, uint64_t seed) {
+    Checksum hash(seed);
+    hash.update(data, size);
+    return hash.finish();
+}
+
+void Checksum::update(void const* data, size_t size) {
+    unsigned char const* bytes = static_cast<unsigned char const*>(data);
+    mSize += size;
+
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, bytes + i, sizeof(word));
+        mState = checksum_mix(mState, word);
+    }
+
+    if (i < size) std::memcpy(&mTail, bytes + i, size - i);
+}
+
+uint64_t Checksum::finish() const {
+    // The tail is mixed in even when empty, zero padded otherwise
+    uint64_t state = checksum_mix(mState, mTail);
+
+    state ^= mSize;
+    state ^= state >> 33;
+    state *= 0xff51afd7ed558ccdull;
+    state ^= state >> 33;
+    return state;
+}
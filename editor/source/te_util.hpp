@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+std::string path_to_string(std::filesystem::path const& path);
+
+// Background work calls this once it has results for the main thread. The editor installs
+// `glfwPostEmptyEvent` here so an event loop blocked while idle picks them up right away.
+// Once `set_wake_handler` returns no thread is still running the previous handler.
+void set_wake_handler(void (*handler)());
+void wake_main_thread();
+
+// Little helpers for the native endian binary files the editor keeps next to its data
+void write_u32(std::ostream& stream, uint32_t value);
+void write_u64(std::ostream& stream, uint64_t value);
+void write_string(std::ostream& stream, std::string const& value);
+
+// Size and mtime of a file, false if either could not be read
+bool file_stamp(std::filesystem::path const& path, uint64_t& size, int64_t& modified);
+
+// Writes through `<path>.<pid>-<n>.tmp` and renames it over `path`, so a crash never leaves a
+// torn file and concurrent writers never share a temp file, the last rename wins.
+// The temp file is removed when `write` returns false, the stream fails or the rename does,
+// `error` only describes the last two.
+bool write_file_atomic(std::filesystem::path const& path, std::function<bool(std::ostream&)> const& write, std::string& error);
+bool write_file_atomic(std::filesystem::path const& path, std::function<bool(std::ostream&)> const& write);
+
+// Word at a time multiply-rotate hash over the editor's own files, tells revisions apart and
+// catches torn writes, nothing more. `seed` chains one hash across several regions.
+uint64_t checksum(void const* data, size_t size, uint64_t seed = 0);
+
+// Same hash fed in pieces, for files read in chunks
+class Checksum final {
+public:
+    explicit Checksum(uint64_t seed = 0) : mState(seed) {}
+
+    // Every piece but the last has to be a whole number of 8 byte words
+    void update(void const* data, size_t size);
+    uint64_t finish() const;
+private:
+    uint64_t mState;
+    uint64_t mTail = 0;
+    uint64_t mSize = 0;
+};
+
+class BinaryReader final {
+public:
+    BinaryReader(std::vector<char> const& data) : mData(data) {}
+
+    template<class T>
+    bool read(T& value) {
+        if (mData.size() - mOffset < sizeof(T)) return false;
+        std::memcpy(&value, mData.data() + mOffset, sizeof(T));
+        mOffset += sizeof(T);
+        return true;
+    }
+
+    bool read(std::string& value) {
+        uint32_t size;
+        if (!read(size) || mData.size() - mOffset < size) return false;
+        value.assign(mData.data() + mOffset, size);
+        mOffset += size;
+        return true;
+    }
+private:
+    std::vector<char> const& mData;
+    size_t mOffset = 0;
+};
@@ -0,0 +1,321 @@
+#include "te_watcher.hpp"
+#include "te_util.hpp"
+#include "te_waveform.hpp"
+
+#include <algorithm>
+#include <optional>
+#include <unordered_map>
+
+#ifdef TE_LINUX
+#   include <sys/eventfd.h>
+#   include <sys/inotify.h>
+#   include <poll.h>
+#   include <unistd.h>
+#endif
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    // A steady trickle of events still gets reported after this long
+    constexpr auto kMaxDelay = std::chrono::seconds(2);
+    // Also how often a root that went away is looked for again
+    constexpr auto kPollInterval = std::chrono::seconds(1);
+
+    struct Debounce final {
+        std::unordered_set<std::string> dirty;
+        bool rescan = false;
+        Clock::time_point first;
+        Clock::time_point last;
+
+        void mark(std::string name) {
+            touch();
+            dirty.emplace(std::move(name));
+        }
+
+        void mark_rescan() {
+            touch();
+            rescan = true;
+        }
+
+        // When the pending changes are due, nothing while there are none
+        std::optional<Clock::time_point> deadline(std::chrono::milliseconds debounce) const {
+            if (dirty.empty() && !rescan) return std::nullopt;
+            return std::min<Clock::time_point>(last + debounce, first + kMaxDelay);
+        }
+
+        bool ready(std::chrono::milliseconds debounce) const {
+            auto const due = deadline(debounce);
+            return due && Clock::now() >= *due;
+        }
+    private:
+        void touch() {
+            last = Clock::now();
+            if (dirty.empty() && !rescan) first = last;
+        }
+    };
+
+    struct Stamp {
+        int64_t modified = 0;
+        uint64_t size = 0;
+        bool operator==(Stamp const&) const = default;
+    };
+
+    // Polling only looks at the details file, that is all a level entry is built from
+    std::unordered_map<std::string, Stamp> stamp_tree(std::filesystem::path const& root) {
+        std::unordered_map<std::string, Stamp> stamps;
+
+        std::error_code ec;
+        for (auto it = std::filesystem::directory_iterator(root, ec); !ec && it != std::filesystem::directory_iterator(); it.increment(ec)) {
+            if (!it->is_directory(ec)) continue;
+
+            Stamp stamp;
+            std::filesystem::path details = it->path() / "LEVEL DETAILS.txt";
+            std::error_code statEc;
+            stamp.size = std::filesystem::file_size(details, statEc);
+            if (!statEc) stamp.modified = std::filesystem::last_write_time(details, statEc).time_since_epoch().count();
+            if (statEc) stamp = {};
+
+            stamps.emplace(path_to_string(it->path().filename()), stamp);
+        }
+
+        return stamps;
+    }
+
+    std::optional<Clock::time_point> earliest(std::optional<Clock::time_point> a, std::optional<Clock::time_point> b) {
+        if (!a || !b) return a ? a : b;
+        return std::min(*a, *b);
+    }
+
+#ifdef TE_LINUX
+    // Rounded up so poll never returns just before the deadline, -1 blocks until an event
+    int poll_timeout(std::optional<Clock::time_point> deadline) {
+        if (!deadline) return -1;
+        auto const remaining = std::chrono::ceil<std::chrono::milliseconds>(*deadline - Clock::now());
+        return static_cast<int>(std::max<int64_t>(remaining.count(), 0));
+    }
+#endif
+}
+
+DirectoryWatcher::DirectoryWatcher(std::filesystem::path root, std::chrono::milliseconds debounce)
+    : mRoot(std::move(root)), mDebounce(debounce) {
+#ifdef TE_LINUX
+    mStopFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+#endif
+    mThread = std::thread(&DirectoryWatcher::run, this);
+}
+
+DirectoryWatcher::~DirectoryWatcher() noexcept {
+    {
+        std::lock_guard lock(mMutex);
+        mStop = true;
+    }
+    mStopCondition.notify_all();
+
+#ifdef TE_LINUX
+    if (mStopFd >= 0) {
+        uint64_t const one = 1;
+        [[maybe_unused]] ssize_t const written = write(mStopFd, &one, sizeof(one));
+    }
+#endif
+
+    mThread.join();
+
+#ifdef TE_LINUX
+    if (mStopFd >= 0) close(mStopFd);
+#endif
+}
+
+bool DirectoryWatcher::take(Changes& changes) {
+    std::lock_guard lock(mMutex);
+    if (mPending.empty() && !mRescan) return false;
+
+    changes.directories.clear();
+    changes.directories.reserve(mPending.size());
+    for (auto const& name : mPending)
+        changes.directories.emplace_back(mRoot / name);
+    changes.rescan = mRescan;
+
+    mPending.clear();
+    mRescan = false;
+    return true;
+}
+
+void DirectoryWatcher::publish(std::unordered_set<std::string>& dirty, bool& rescan) {
+    {
+        std::lock_guard lock(mMutex);
+        mPending.merge(dirty);
+        mRescan |= rescan;
+    }
+
+    wake_main_thread();
+
+    dirty.clear();
+    rescan = false;
+}
+
+void DirectoryWatcher::run() {
+    if (run_inotify()) return;
+    run_polling();
+}
+
+bool DirectoryWatcher::run_inotify() {
+#ifdef TE_LINUX
+    // Without a way to wake it for shutdown the loop could never block
+    if (mStopFd < 0) return false;
+
+    int const fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0) return false;
+
+    constexpr uint32_t kRootMask = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR;
+    constexpr uint32_t kLevelMask = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_CLOSE_WRITE | IN_ONLYDIR;
+
+    std::string const rootPath = path_to_string(mRoot);
+    int rootWatch = -1;
+
+    // Watch descriptor -> subdirectory name
+    std::unordered_map<int, std::string> watches;
+    auto const watch = [&](std::string const& name) {
+        int const wd = inotify_add_watch(fd, (rootPath + "/" + name).c_str(), kLevelMask);
+        if (wd >= 0) watches[wd] = name;
+    };
+
+    // False while the root does not exist
+    auto const watch_root = [&]() {
+        rootWatch = inotify_add_watch(fd, rootPath.c_str(), kRootMask);
+        if (rootWatch < 0) return false;
+
+        std::error_code ec;
+        for (auto it = std::filesystem::directory_iterator(mRoot, ec); !ec && it != std::filesystem::directory_iterator(); it.increment(ec)) {
+            if (it->is_directory(ec)) watch(path_to_string(it->path().filename()));
+        }
+        return true;
+    };
+
+    // A moved root keeps its watches on the old inode, they would report under the wrong names
+    auto const unwatch_root = [&]() {
+        inotify_rm_watch(fd, rootWatch);
+        for (auto const& [wd, name] : watches)
+            inotify_rm_watch(fd, wd);
+        watches.clear();
+        rootWatch = -1;
+    };
+
+    if (!watch_root()) {
+        close(fd);
+        return false;
+    }
+
+    mNative = true;
+
+    Debounce debounce;
+    std::optional<Clock::time_point> rootRetry;
+    alignas(inotify_event) char buffer[16 * 1024];
+
+    while (!mStop.load(std::memory_order_relaxed)) {
+        pollfd fds[] = {
+            { .fd = fd, .events = POLLIN, .revents = 0 },
+            { .fd = mStopFd, .events = POLLIN, .revents = 0 },
+        };
+        poll(fds, std::size(fds), poll_timeout(earliest(debounce.deadline(mDebounce), rootRetry)));
+        if (mStop.load(std::memory_order_relaxed)) break;
+
+        while (true) {
+            ssize_t const size = read(fd, buffer, sizeof(buffer));
+            if (size <= 0) break;
+
+            for (char* ptr = buffer; ptr < buffer + size;) {
+                auto const* event = reinterpret_cast<inotify_event const*>(ptr);
+                ptr += sizeof(inotify_event) + event->len;
+
+                if (event->mask & IN_Q_OVERFLOW) {
+                    debounce.mark_rescan();
+                    continue;
+                }
+
+                if (event->wd == rootWatch) {
+                    if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF)) {
+                        debounce.mark_rescan();
+                        unwatch_root();
+                        // A replacement may already be in place, rsync and checkouts swap it in one go
+                        rootRetry = Clock::now();
+                        continue;
+                    }
+
+                    if (event->len == 0 || !(event->mask & IN_ISDIR)) continue;
+
+                    std::string name = event->name;
+                    if (event->mask & (IN_CREATE | IN_MOVED_TO)) watch(name);
+                    debounce.mark(std::move(name));
+                    continue;
+                }
+
+                auto it = watches.find(event->wd);
+                if (it == watches.end()) continue;
+
+                // Writing a waveform cache next to a track does not change the level
+                if (event->len > 0 && is_peak_cache(event->name)) continue;
+
+                if (event->mask & IN_IGNORED) {
+                    debounce.mark(it->second);
+                    watches.erase(it);
+                    continue;
+                }
+
+                debounce.mark(it->second);
+            }
+        }
+
+        // Nothing is reported about a root that does not exist, it is looked for until it does
+        if (rootRetry && Clock::now() >= *rootRetry) {
+            if (watch_root()) {
+                debounce.mark_rescan();
+                rootRetry.reset();
+            }
+            else {
+                rootRetry = Clock::now() + kPollInterval;
+            }
+        }
+
+        if (debounce.ready(mDebounce)) publish(debounce.dirty, debounce.rescan);
+    }
+
+    close(fd);
+    return true;
+#else
+    return false;
+#endif
+}
+
+void DirectoryWatcher::run_polling() {
+    mNative = false;
+
+    Debounce debounce;
+    auto stamps = stamp_tree(mRoot);
+    auto nextPoll = Clock::now() + kPollInterval;
+
+    while (true) {
+        {
+            std::unique_lock lock(mMutex);
+            Clock::time_point const wake = earliest(debounce.deadline(mDebounce), nextPoll).value();
+            if (mStopCondition.wait_until(lock, wake, [this]() { return mStop.load(std::memory_order_relaxed); })) break;
+        }
+
+        if (Clock::now() >= nextPoll) {
+            auto current = stamp_tree(mRoot);
+
+            for (auto const& [name, stamp] : current) {
+                auto it = stamps.find(name);
+                if (it == stamps.end() || it->second != stamp) debounce.mark(name);
+            }
+
+            for (auto const& [name, stamp] : stamps) {
+                if (!current.contains(name)) debounce.mark(name);
+            }
+
+            stamps = std::move(current);
+            nextPoll = Clock::now() + kPollInterval;
+        }
+
+        if (debounce.ready(mDebounce)) publish(debounce.dirty, debounce.rescan);
+    }
+}
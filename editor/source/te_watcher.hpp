@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+// Watches a directory and its immediate subdirectories on a background thread.
+// Uses inotify on linux and falls back to polling file stamps elsewhere or when
+// inotify is unavailable. Events are coalesced until the tree has been quiet for
+// the debounce period so a bulk copy is reported as a single batch. With inotify the
+// thread sleeps until an event or a debounce deadline. A root that is deleted or replaced
+// is watched again once it exists, followed by a rescan.
+class DirectoryWatcher final {
+public:
+    struct Changes {
+        // Subdirectories that were created, modified or removed
+        std::vector<std::filesystem::path> directories;
+
+        // Events were lost, the whole tree must be rescanned
+        bool rescan = false;
+    };
+
+    explicit DirectoryWatcher(std::filesystem::path root, std::chrono::milliseconds debounce = std::chrono::milliseconds(250));
+    ~DirectoryWatcher() noexcept;
+
+    DirectoryWatcher(DirectoryWatcher const&) = delete;
+    DirectoryWatcher& operator=(DirectoryWatcher const&) = delete;
+
+    // Non blocking, returns false when nothing changed since the last call
+    bool take(Changes& changes);
+
+    // False when running the polling fallback
+    inline bool native() const { return mNative.load(std::memory_order_relaxed); }
+private:
+    void run();
+    bool run_inotify();
+    void run_polling();
+
+    void publish(std::unordered_set<std::string>& dirty, bool& rescan);
+
+    std::filesystem::path mRoot;
+    std::chrono::milliseconds mDebounce;
+
+    std::atomic<bool> mStop = false;
+    std::atomic<bool> mNative = false;
+    // Wakes the inotify loop for shutdown, linux only
+    int mStopFd = -1;
+
+    std::mutex mMutex;
+    // Wakes the polling loop for shutdown
+    std::condition_variable mStopCondition;
+    std::unordered_set<std::string> mPending;
+    bool mRescan = false;
+
+    std::thread mThread;
+};
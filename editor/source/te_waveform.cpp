@@ -0,0 +1,366 @@
+#include "te_waveform.hpp"
+#include "te_profiler.hpp"
+#include "te_thread_pool.hpp"
+#include "te_util.hpp"
+
+#include <miniaudio.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <thread>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#   define TE_WAVEFORM_SSE
+#   include <immintrin.h>
+#endif
+
+static_assert(sizeof(PeakBin) == 6);
+
+namespace {
+    constexpr char kCacheMagic[4] = { 'T', 'E', 'P', 'K' };
+    constexpr uint32_t kCacheVersion = 1;
+
+    // Frames decoded per read, a whole number of bins
+    constexpr size_t kChunkFrames = PeakPyramid::kBaseBinFrames * 1024;
+
+    // Tracks shorter than two of these are decoded in one go, a seek costs more than it saves
+    constexpr uint64_t kMinRangeFrames = 48000 * 15;
+
+    // Bins are only drawn, so unlike the level snapshot there is no checksum, a damaged
+    // cache just draws wrong until the track changes
+    struct CacheHeader {
+        char magic[4];
+        uint32_t version;
+        uint32_t sampleRate;
+        uint32_t reserved;
+        uint64_t frames;
+        uint64_t sourceSize;
+        int64_t sourceModified;
+        // Across every level
+        uint64_t binCount;
+    };
+
+    static_assert(sizeof(CacheHeader) == 48);
+
+    int16_t to_sample(float value) {
+        return static_cast<int16_t>(std::lround(std::clamp(value, -1.0f, 1.0f) * 32767.0f));
+    }
+
+    PeakBin make_bin(float min, float max, float squares, size_t count) {
+        return { to_sample(min), to_sample(max), to_sample(std::sqrt(squares / static_cast<float>(count))) };
+    }
+
+    // Bins in each level, finest first, down to a single one
+    std::vector<size_t> level_sizes(uint64_t frames) {
+        std::vector<size_t> sizes;
+
+        size_t count = static_cast<size_t>((frames + PeakPyramid::kBaseBinFrames - 1) / PeakPyramid::kBaseBinFrames);
+        if (count == 0) return sizes;
+
+        sizes.push_back(count);
+        while (count > 1) {
+            count = (count + 1) / 2;
+            sizes.push_back(count);
+        }
+
+        return sizes;
+    }
+
+    bool init_decoder(std::filesystem::path const& path, ma_decoder& decoder) {
+        // The decoder mixes down to the single channel the waveform shows
+        ma_decoder_config const config = ma_decoder_config_init(ma_format_f32, 1, 0);
+#ifdef TE_WINDOWS
+        return ma_decoder_init_file_w(path.c_str(), &config, &decoder) == MA_SUCCESS;
+#else
+        return ma_decoder_init_file(path.c_str(), &config, &decoder) == MA_SUCCESS;
+#endif
+    }
+
+    // Finest level bins of frames [begin, end), `end` may lie past the end of the track
+    bool decode_range(std::filesystem::path const& path, uint64_t begin, uint64_t end, std::atomic<bool> const& cancelled, std::vector<PeakBin>& bins, uint64_t& frames) {
+        ma_decoder decoder;
+        if (!init_decoder(path, decoder)) return false;
+
+        bool const ok = begin == 0 || ma_decoder_seek_to_pcm_frame(&decoder, begin) == MA_SUCCESS;
+        std::vector<float> buffer(kChunkFrames);
+        frames = 0;
+
+        while (ok && frames < end - begin && !cancelled.load(std::memory_order_relaxed)) {
+            size_t const want = static_cast<size_t>(std::min<uint64_t>(kChunkFrames, end - begin - frames));
+
+            // Reads only come back short at the end of the track, only then can a bin be partial
+            size_t filled = 0;
+            while (filled < want) {
+                ma_uint64 read = 0;
+                ma_decoder_read_pcm_frames(&decoder, buffer.data() + filled, want - filled, &read);
+                if (read == 0) break;
+                filled += static_cast<size_t>(read);
+            }
+
+            if (filled == 0) break;
+
+            size_t const first = bins.size();
+            bins.resize(first + (filled + PeakPyramid::kBaseBinFrames - 1) / PeakPyramid::kBaseBinFrames);
+            reduce_peaks(buffer.data(), filled, bins.data() + first);
+            frames += filled;
+
+            if (filled < want) break;
+        }
+
+        ma_decoder_uninit(&decoder);
+        return ok;
+    }
+}
+
+void reduce_peaks(float const* samples, size_t frames, PeakBin* out) {
+    constexpr size_t kBin = PeakPyramid::kBaseBinFrames;
+    size_t i = 0;
+
+#ifdef TE_WAVEFORM_SSE
+    // Four lanes side by side, folded together once per bin
+    for (; i + kBin <= frames; i += kBin) {
+        __m128 min = _mm_loadu_ps(samples + i);
+        __m128 max = min;
+        __m128 squares = _mm_mul_ps(min, min);
+
+        for (size_t k = 4; k < kBin; k += 4) {
+            __m128 const value = _mm_loadu_ps(samples + i + k);
+            min = _mm_min_ps(min, value);
+            max = _mm_max_ps(max, value);
+            squares = _mm_add_ps(squares, _mm_mul_ps(value, value));
+        }
+
+        min = _mm_min_ps(min, _mm_movehl_ps(min, min));
+        min = _mm_min_ss(min, _mm_shuffle_ps(min, min, 1));
+        max = _mm_max_ps(max, _mm_movehl_ps(max, max));
+        max = _mm_max_ss(max, _mm_shuffle_ps(max, max, 1));
+        squares = _mm_add_ps(squares, _mm_movehl_ps(squares, squares));
+        squares = _mm_add_ss(squares, _mm_shuffle_ps(squares, squares, 1));
+
+        *out++ = make_bin(_mm_cvtss_f32(min), _mm_cvtss_f32(max), _mm_cvtss_f32(squares), kBin);
+    }
+#endif
+
+    for (; i < frames; i += kBin) {
+        size_t const count = std::min(kBin, frames - i);
+        float min = samples[i], max = samples[i], squares = 0.0f;
+
+        for (size_t k = i; k < i + count; ++k) {
+            min = std::min(min, samples[k]);
+            max = std::max(max, samples[k]);
+            squares += samples[k] * samples[k];
+        }
+
+        *out++ = make_bin(min, max, squares, count);
+    }
+}
+
+void PeakPyramid::assign(uint32_t sampleRate, uint64_t frames, std::vector<PeakBin> base) {
+    mFile.close();
+    mSampleRate = sampleRate;
+    mFrames = frames;
+
+    std::vector<size_t> const sizes = level_sizes(frames);
+    base.resize(sizes.empty() ? 0 : sizes[0], PeakBin{ 0, 0, 0 });
+
+    mOwnedBins = std::move(base);
+    mOwnedBins.reserve(std::accumulate(sizes.begin(), sizes.end(), size_t(0)));
+
+    // A level's last bin may have no partner, it then carries over as it is
+    size_t begin = 0;
+    for (size_t level = 1; level < sizes.size(); ++level) {
+        size_t const previous = sizes[level - 1];
+
+        for (size_t i = 0; i < sizes[level]; ++i) {
+            PeakBin const a = mOwnedBins[begin + 2 * i];
+            PeakBin const b = 2 * i + 1 < previous ? mOwnedBins[begin + 2 * i + 1] : a;
+
+            float const rms = std::sqrt((static_cast<float>(a.rms) * a.rms + static_cast<float>(b.rms) * b.rms) * 0.5f);
+            mOwnedBins.push_back({ std::min(a.min, b.min), std::max(a.max, b.max), static_cast<int16_t>(std::lround(rms)) });
+        }
+
+        begin += previous;
+    }
+
+    mBins = mOwnedBins;
+    split_levels();
+}
+
+size_t PeakPyramid::level_for(double framesPerPixel) const {
+    size_t level = 0;
+    while (level + 1 < mLevels.size() && static_cast<double>(bin_frames(level + 1)) <= framesPerPixel) ++level;
+    return level;
+}
+
+void PeakPyramid::split_levels() {
+    mLevels.clear();
+
+    size_t begin = 0;
+    for (size_t size : level_sizes(mFrames)) {
+        mLevels.push_back(mBins.subspan(begin, size));
+        begin += size;
+    }
+}
+
+bool PeakPyramid::map(std::filesystem::path const& path, uint64_t sourceSize, int64_t sourceModified) {
+    MappedFile file;
+    if (!file.open(path)) return false;
+
+    auto const bytes = file.bytes();
+    if (bytes.size() < sizeof(CacheHeader)) return false;
+
+    CacheHeader header;
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    if (std::memcmp(header.magic, kCacheMagic, sizeof(header.magic)) != 0 || header.version != kCacheVersion) return false;
+    if (header.sourceSize != sourceSize || header.sourceModified != sourceModified || header.sampleRate == 0) return false;
+
+    std::vector<size_t> const sizes = level_sizes(header.frames);
+    uint64_t const binCount = std::accumulate(sizes.begin(), sizes.end(), uint64_t(0));
+    if (header.binCount != binCount || bytes.size() != sizeof(CacheHeader) + binCount * sizeof(PeakBin)) return false;
+
+    mOwnedBins.clear();
+    mFile = std::move(file);
+    mSampleRate = header.sampleRate;
+    mFrames = header.frames;
+    mBins = { reinterpret_cast<PeakBin const*>(bytes.data() + sizeof(CacheHeader)), static_cast<size_t>(binCount) };
+    split_levels();
+    return true;
+}
+
+bool PeakPyramid::save(std::filesystem::path const& path, uint64_t sourceSize, int64_t sourceModified) const {
+    CacheHeader header{};
+    std::memcpy(header.magic, kCacheMagic, sizeof(header.magic));
+    header.version = kCacheVersion;
+    header.sampleRate = mSampleRate;
+    header.frames = mFrames;
+    header.sourceSize = sourceSize;
+    header.sourceModified = sourceModified;
+    header.binCount = mBins.size();
+
+    return write_file_atomic(path, [&](std::ostream& file) {
+        file.write(reinterpret_cast<char const*>(&header), sizeof(header));
+        file.write(reinterpret_cast<char const*>(mBins.data()), static_cast<std::streamsize>(mBins.size_bytes()));
+        return true;
+    });
+}
+
+struct WaveformCache::Pending {
+    std::filesystem::path track;
+    std::filesystem::path cache;
+    uint64_t sourceSize = 0;
+    int64_t sourceModified = 0;
+    uint32_t sampleRate = 0;
+
+    std::atomic<bool> cancelled = false;
+    std::atomic<bool> failed = false;
+    std::atomic<size_t> outstanding = 0;
+
+    // One per range, each only touched by its own task until the last one stitches them
+    std::vector<std::vector<PeakBin>> ranges;
+    std::vector<uint64_t> rangeFrames;
+
+    // Published through `finished`, stays null when the track could not be decoded
+    std::unique_ptr<PeakPyramid> pyramid;
+    std::atomic<bool> finished = false;
+};
+
+WaveformCache::WaveformCache(ThreadPool& pool) : mPool(pool) {
+}
+
+void WaveformCache::open(std::filesystem::path track) {
+    if (track == mTrack && (mPyramid || mPending)) return;
+
+    cancel();
+    mTrack = track;
+    mPyramid.reset();
+
+    auto pending = std::make_shared<Pending>();
+    pending->track = std::move(track);
+    pending->cache = pending->track;
+    pending->cache += kPeakCacheSuffix;
+    mPending = pending;
+
+    auto const finish = [](std::shared_ptr<Pending> const& pending) {
+        pending->finished.store(true, std::memory_order_release);
+        wake_main_thread();
+    };
+
+    mPool.submit([pending, finish, &pool = mPool]() {
+        TE_PROFILE_ZONE("Waveform Open");
+
+        if (!file_stamp(pending->track, pending->sourceSize, pending->sourceModified)) return finish(pending);
+
+        auto pyramid = std::make_unique<PeakPyramid>();
+        if (pyramid->map(pending->cache, pending->sourceSize, pending->sourceModified)) {
+            pending->pyramid = std::move(pyramid);
+            return finish(pending);
+        }
+
+        ma_decoder decoder;
+        if (!init_decoder(pending->track, decoder)) return finish(pending);
+
+        ma_uint64 length = 0;
+        if (ma_decoder_get_length_in_pcm_frames(&decoder, &length) != MA_SUCCESS) length = 0;
+        pending->sampleRate = decoder.outputSampleRate;
+        ma_decoder_uninit(&decoder);
+
+        // Each range seeks to its start on its own decoder, so long tracks decode on every thread
+        // at once. A track of unknown length is read as one range to the end.
+        size_t const threads = std::max(1u, std::thread::hardware_concurrency());
+        size_t const count = length > 0 ? std::clamp<size_t>(static_cast<size_t>(length / kMinRangeFrames), 1, threads) : 1;
+        uint64_t const step = (length / count + PeakPyramid::kBaseBinFrames - 1) / PeakPyramid::kBaseBinFrames * PeakPyramid::kBaseBinFrames;
+
+        pending->ranges.resize(count);
+        pending->rangeFrames.resize(count);
+        pending->outstanding.store(count, std::memory_order_relaxed);
+
+        for (size_t range = 0; range < count; ++range) {
+            uint64_t const begin = range * step;
+            uint64_t const end = range + 1 == count ? UINT64_MAX : begin + step;
+
+            pool.submit([pending, finish, range, begin, end]() {
+                TE_PROFILE_ZONE("Waveform Range");
+
+                if (!decode_range(pending->track, begin, end, pending->cancelled, pending->ranges[range], pending->rangeFrames[range]))
+                    pending->failed.store(true, std::memory_order_relaxed);
+
+                if (pending->outstanding.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+
+                // The last range to finish stitches them together
+                if (!pending->failed.load(std::memory_order_relaxed) && !pending->cancelled.load(std::memory_order_relaxed)) {
+                    std::vector<PeakBin> base;
+                    uint64_t frames = 0;
+                    for (size_t i = 0; i < pending->ranges.size(); ++i) {
+                        base.insert(base.end(), pending->ranges[i].begin(), pending->ranges[i].end());
+                        frames += pending->rangeFrames[i];
+                    }
+
+                    auto pyramid = std::make_unique<PeakPyramid>();
+                    pyramid->assign(pending->sampleRate, frames, std::move(base));
+                    pyramid->save(pending->cache, pending->sourceSize, pending->sourceModified);
+                    pending->pyramid = std::move(pyramid);
+                }
+
+                finish(pending);
+            });
+        }
+    });
+}
+
+void WaveformCache::cancel() {
+    if (!mPending) return;
+
+    mPending->cancelled.store(true, std::memory_order_relaxed);
+    mPending.reset();
+}
+
+bool WaveformCache::poll() {
+    if (!mPending || !mPending->finished.load(std::memory_order_acquire)) return false;
+
+    mPyramid = std::move(mPending->pyramid);
+    mPending.reset();
+    return true;
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "te_mapped_file.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <vector>
+
+class ThreadPool;
+
+// Appended to the track's file name, the cache lives next to it in the level directory
+inline constexpr char const* kPeakCacheSuffix = ".tepeaks";
+
+// Caches are left out when deploying or packing a level, so is the temporary file an
+// interrupted save leaves behind
+inline bool is_peak_cache(std::filesystem::path const& path) {
+    // `write_file_atomic` names it `<cache>.<pid>-<n>.tmp`
+    if (path.extension() == ".tmp") return path.stem().stem().extension() == kPeakCacheSuffix;
+    return path.extension() == kPeakCacheSuffix;
+}
+
+// One bin of a mono mixdown, full scale is 32767
+struct PeakBin {
+    int16_t min;
+    int16_t max;
+    int16_t rms;
+};
+
+// Peaks of a whole track at every power of two zoom. The finest level has a bin per
+// `kBaseBinFrames` frames and each level above merges pairs from the one below, so any
+// zoom is drawn from a level with about one bin per pixel.
+class PeakPyramid final {
+public:
+    static constexpr uint32_t kBaseBinFrames = 64;
+
+    PeakPyramid() = default;
+
+    PeakPyramid(PeakPyramid const&) = delete;
+    PeakPyramid& operator=(PeakPyramid const&) = delete;
+
+    // Builds every coarser level from the finest one
+    void assign(uint32_t sampleRate, uint64_t frames, std::vector<PeakBin> base);
+
+    inline uint32_t sample_rate() const { return mSampleRate; }
+    inline uint64_t frames() const { return mFrames; }
+
+    inline size_t level_count() const { return mLevels.size(); }
+    inline std::span<PeakBin const> level(size_t index) const { return mLevels[index]; }
+    inline uint64_t bin_frames(size_t level) const { return static_cast<uint64_t>(kBaseBinFrames) << level; }
+    // Coarsest level whose bins are no wider than `framesPerPixel`, the finest when even that is too wide
+    size_t level_for(double framesPerPixel) const;
+
+    // The cache is only used while the track keeps the size and mtime it was built from
+    bool map(std::filesystem::path const& path, uint64_t sourceSize, int64_t sourceModified);
+    bool save(std::filesystem::path const& path, uint64_t sourceSize, int64_t sourceModified) const;
+private:
+    void split_levels();
+
+    uint32_t mSampleRate = 0;
+    uint64_t mFrames = 0;
+
+    // Every level back to back, finest first, pointing into `mFile` or `mOwnedBins`
+    std::span<PeakBin const> mBins;
+    std::vector<std::span<PeakBin const>> mLevels;
+
+    std::vector<PeakBin> mOwnedBins;
+    MappedFile mFile;
+};
+
+// Min, max and rms of `frames` mono samples into one bin per `PeakPyramid::kBaseBinFrames`,
+// the last bin may cover fewer. `out` needs room for every bin.
+void reduce_peaks(float const* samples, size_t frames, PeakBin* out);
+
+// Pyramid of one track at a time, the one being previewed. A cache next to the track is
+// used while it is fresh, otherwise the track is decoded in ranges across the pool and
+// the cache written again.
+class WaveformCache final {
+public:
+    explicit WaveformCache(ThreadPool& pool);
+
+    WaveformCache(WaveformCache const&) = delete;
+    WaveformCache& operator=(WaveformCache const&) = delete;
+
+    // Does nothing if `track` is already shown or loading
+    void open(std::filesystem::path track);
+
+    // Abandons a load in flight, decoding stops at the next chunk of each range
+    void cancel();
+
+    // Returns true when a pyramid finished loading
+    bool poll();
+
+    inline bool loading() const { return mPending != nullptr; }
+    inline std::filesystem::path const& track() const { return mTrack; }
+    // Null while loading or when the track could not be decoded
+    inline PeakPyramid const* pyramid() const { return mPyramid.get(); }
+private:
+    struct Pending;
+
+    ThreadPool& mPool;
+    std::filesystem::path mTrack;
+    std::unique_ptr<PeakPyramid> mPyramid;
+    std::shared_ptr<Pending> mPending;
+};
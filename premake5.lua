@@ -42,4 +42,5 @@ for _, matchedfile in ipairs(os.matchfiles("premake/*.lua")) do
 end
 group ""
 
-include "editor/build.lua"
\ No newline at end of file
+include "editor/build.lua"
+include "bench/build.lua"
\ No newline at end of file